@@ -0,0 +1,147 @@
+/* Win detection over many independent bitboards at once.
+ *
+ * In userspace the segment masks are tested against two boards per AVX2
+ * vector or one per SSE2 vector, whichever the CPU supports. The kernel build
+ * stays scalar: the vector registers would have to be saved with
+ * kernel_fpu_begin() around every batch, and kbuild compiles with the SIMD
+ * instruction sets disabled anyway.
+ */
+
+#include <linux/kernel.h>
+
+#include "bitboard.h"
+#include "game_tables.h"
+
+#if !defined(__KERNEL__) && defined(__x86_64__)
+#define HAVE_SIMD_BATCH 1
+#include <immintrin.h>
+#endif
+
+/* Turn the per-side "has a line" flags of a board into a check_win() result.
+ * Both sides holding a line cannot happen in a real game; rescan such boards
+ * so the result still matches check_win() exactly.
+ */
+static inline char batch_result(const struct bitboard *b, bool o, bool x)
+{
+    if (o && x)
+        return check_win_bitboard(b);
+    if (o)
+        return 'O';
+    if (x)
+        return 'X';
+    return bitboard_empty(b) ? ' ' : 'D';
+}
+
+static void check_win_batch_scalar(const struct bitboard *boards,
+                                   int n,
+                                   char *results)
+{
+    for (int i = 0; i < n; i++)
+        results[i] = check_win_bitboard(&boards[i]);
+}
+
+#ifdef HAVE_SIMD_BATCH
+/* SSE2 has no 64-bit compare, so build it from the 32-bit one */
+static inline __m128i sse2_cmpeq_epi64(__m128i a, __m128i b)
+{
+    __m128i eq = _mm_cmpeq_epi32(a, b);
+    return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+/* One board per vector: lane 0 holds O, lane 1 holds X */
+static void check_win_batch_sse2(const struct bitboard *boards,
+                                 int n,
+                                 char *results)
+{
+    for (int i = 0; i < n; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &boards[i]);
+        __m128i won = _mm_setzero_si128();
+        UNROLL_SEGMENTS
+        for (int s = 0; s < N_SEGMENTS; s++) {
+            __m128i m = _mm_set1_epi64x(segment_masks[s]);
+            __m128i hit = sse2_cmpeq_epi64(_mm_and_si128(v, m), m);
+#if !ALLOW_EXCEED
+            __m128i g = _mm_set1_epi64x(segment_guard_masks[s]);
+            hit = _mm_and_si128(hit, sse2_cmpeq_epi64(_mm_and_si128(v, g),
+                                                      _mm_setzero_si128()));
+#endif
+            won = _mm_or_si128(won, hit);
+        }
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(won));
+        results[i] = batch_result(&boards[i], mask & 1, mask & 2);
+    }
+}
+
+/* Two boards per vector: lanes hold O and X of board i, then of board i + 1 */
+__attribute__((target("avx2"))) static void check_win_batch_avx2(
+    const struct bitboard *boards,
+    int n,
+    char *results)
+{
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &boards[i]);
+        __m256i won = _mm256_setzero_si256();
+        UNROLL_SEGMENTS
+        for (int s = 0; s < N_SEGMENTS; s++) {
+            __m256i m = _mm256_set1_epi64x(segment_masks[s]);
+            __m256i hit = _mm256_cmpeq_epi64(_mm256_and_si256(v, m), m);
+#if !ALLOW_EXCEED
+            __m256i g = _mm256_set1_epi64x(segment_guard_masks[s]);
+            hit = _mm256_and_si256(
+                hit, _mm256_cmpeq_epi64(_mm256_and_si256(v, g),
+                                        _mm256_setzero_si256()));
+#endif
+            won = _mm256_or_si256(won, hit);
+        }
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(won));
+        results[i] = batch_result(&boards[i], mask & 1, mask & 2);
+        results[i + 1] = batch_result(&boards[i + 1], mask & 4, mask & 8);
+    }
+    check_win_batch_sse2(boards + i, n - i, results + i);
+}
+#endif
+
+static const struct {
+    const char *name;
+    void (*fn)(const struct bitboard *boards, int n, char *results);
+} batch_impls[] = {
+    [BATCH_SCALAR] = {"scalar", check_win_batch_scalar},
+#ifdef HAVE_SIMD_BATCH
+    [BATCH_SSE2] = {"sse2", check_win_batch_sse2},
+    [BATCH_AVX2] = {"avx2", check_win_batch_avx2},
+#endif
+};
+
+static void (*batch_fn)(const struct bitboard *boards, int n, char *results);
+
+static bool batch_impl_supported(enum batch_impl impl)
+{
+    if ((unsigned) impl >= ARRAY_SIZE(batch_impls) || !batch_impls[impl].fn)
+        return false;
+#ifdef HAVE_SIMD_BATCH
+    if (impl == BATCH_AVX2)
+        return __builtin_cpu_supports("avx2");
+#endif
+    return true;
+}
+
+const char *check_win_batch_select(enum batch_impl impl)
+{
+    if (impl == BATCH_AUTO) {
+        impl = BATCH_AVX2;
+        while (!batch_impl_supported(impl))
+            impl--;
+    }
+    if (!batch_impl_supported(impl))
+        return NULL;
+    batch_fn = batch_impls[impl].fn;
+    return batch_impls[impl].name;
+}
+
+void check_win_batch(const struct bitboard *boards, int n, char *results)
+{
+    if (unlikely(!batch_fn))
+        check_win_batch_select(BATCH_AUTO);
+    batch_fn(boards, n, results);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <linux/bitops.h>
+#include <linux/types.h>
+
+#include "game.h"
+#include "game_tables.h"
+
+#if N_GRIDS > 64
+#error "bitboards hold at most 64 squares, use BOARD_SIZE <= 8"
+#endif
+
+#define BOARD_MASK (~0ULL >> (64 - N_GRIDS))
+
+/* Board with one bit per square for the marks of each side */
+struct bitboard {
+    u64 o, x;
+};
+
+static inline void bitboard_from_table(struct bitboard *b, const char *table)
+{
+    b->o = b->x = 0;
+    for (int i = 0; i < N_GRIDS; i++) {
+        if (table[i] == 'O')
+            b->o |= 1ULL << i;
+        else if (table[i] == 'X')
+            b->x |= 1ULL << i;
+    }
+}
+
+static inline u64 bitboard_empty(const struct bitboard *b)
+{
+    return BOARD_MASK & ~(b->o | b->x);
+}
+
+/* Index of the @n-th (from 0) lowest set bit of @bits */
+static inline int bitboard_nth(u64 bits, int n)
+{
+    while (n--)
+        bits &= bits - 1;
+    return __ffs64(bits);
+}
+
+static inline bool segment_won(u64 marks, int s)
+{
+    if ((marks & segment_masks[s]) != segment_masks[s])
+        return false;
+#if !ALLOW_EXCEED
+    if (marks & segment_guard_masks[s])
+        return false;
+#endif
+    return true;
+}
+
+/* Whether @marks of one side, which just got @square, now win. Only the
+ * segments going through @square need to be looked at.
+ */
+static inline bool bitboard_wins_at(u64 marks, int square)
+{
+    for (int i = 0; i < square_n_segments[square]; i++)
+        if (segment_won(marks, square_segments[square][i]))
+            return true;
+    return false;
+}
+
+/* Same as check_win(), on a bitboard */
+char check_win_bitboard(const struct bitboard *b);
+
+/* Implementations of check_win_batch() */
+enum batch_impl { BATCH_AUTO, BATCH_SCALAR, BATCH_SSE2, BATCH_AVX2 };
+
+/* Store check_win() of each of the @n @boards into @results */
+void check_win_batch(const struct bitboard *boards, int n, char *results);
+
+/* Choose the implementation used by check_win_batch(), BATCH_AUTO meaning the
+ * fastest one this CPU supports. Returns its name, or NULL if @impl is not
+ * available in this build or on this CPU.
+ */
+const char *check_win_batch_select(enum batch_impl impl);
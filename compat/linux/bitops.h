@@ -0,0 +1,16 @@
+/* Userspace stand-in for <linux/bitops.h> */
+
+#pragma once
+
+#include <linux/types.h>
+
+static inline unsigned int hweight64(u64 w)
+{
+    return __builtin_popcountll(w);
+}
+
+/* Index of the lowest set bit, undefined if @word is 0 */
+static inline unsigned long __ffs64(u64 word)
+{
+    return __builtin_ctzll(word);
+}
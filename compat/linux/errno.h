@@ -0,0 +1,8 @@
+/* Userspace stand-in for <linux/errno.h>: the error numbers come from the
+ * uapi header of the same name, which <errno.h> also includes through this
+ * one.
+ */
+
+#pragma once
+
+#include_next <linux/errno.h>
@@ -0,0 +1,8 @@
+/* Userspace stand-in for <linux/kernel.h> */
+
+#pragma once
+
+#include <linux/printk.h>
+#include <linux/types.h>
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
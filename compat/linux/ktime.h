@@ -0,0 +1,19 @@
+/* Userspace stand-in for <linux/ktime.h>, backed by CLOCK_MONOTONIC */
+
+#pragma once
+
+#include <time.h>
+
+#include <linux/types.h>
+
+typedef s64 ktime_t;
+
+static inline ktime_t ktime_get(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ktime_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#define ktime_sub(a, b) ((a) - (b))
+#define ktime_to_ns(kt) ((s64) (kt))
@@ -0,0 +1,12 @@
+/* Userspace stand-in for <linux/printk.h>: messages go to stderr */
+
+#pragma once
+
+#include <stdio.h>
+
+#define pr_err(fmt, ...) fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...) fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...) fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...) \
+    do {                   \
+    } while (0)
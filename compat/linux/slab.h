@@ -0,0 +1,45 @@
+/* Userspace stand-in for <linux/slab.h>: the kmalloc() family maps onto the C
+ * library allocator and the GFP flags are ignored.
+ *
+ * The kernel version of this header drags in most of the core kernel
+ * definitions, and the engine sources rely on that (e.g. zobrist.c calls
+ * ktime_get() without including <linux/ktime.h>), so do the same here.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/ktime.h>
+#include <linux/printk.h>
+#include <linux/types.h>
+
+typedef unsigned int gfp_t;
+
+#define GFP_KERNEL 0U
+#define GFP_ATOMIC 0U
+#define GFP_KERNEL_ACCOUNT 0U
+
+static inline void *kmalloc(size_t size, gfp_t flags)
+{
+    (void) flags;
+    return malloc(size);
+}
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+    (void) flags;
+    return calloc(1, size);
+}
+
+static inline void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+    (void) flags;
+    return calloc(n, size);
+}
+
+static inline void kfree(const void *p)
+{
+    free((void *) p);
+}
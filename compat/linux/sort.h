@@ -0,0 +1,22 @@
+/* Userspace stand-in for <linux/sort.h>
+ *
+ * The kernel implementation is a heapsort while qsort() is not, so elements
+ * comparing equal may end up in a different order than in kxo.ko.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+
+typedef int (*cmp_func_t)(const void *a, const void *b);
+typedef void (*swap_func_t)(void *a, void *b, int size);
+
+static inline void sort(void *base,
+                        size_t num,
+                        size_t size,
+                        cmp_func_t cmp_func,
+                        swap_func_t swap_func)
+{
+    (void) swap_func;
+    qsort(base, num, size, cmp_func);
+}
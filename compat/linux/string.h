@@ -0,0 +1,5 @@
+/* Userspace stand-in for <linux/string.h> */
+
+#pragma once
+
+#include <string.h>
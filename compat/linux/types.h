@@ -0,0 +1,34 @@
+/* Userspace stand-in for <linux/types.h>, used when the game engines are
+ * built outside of the kernel (see the "engine" target in Makefile).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef unsigned __int128 u128;
+
+/* Fixed-size types of the user/kernel interfaces, such as kxo_ioctl.h */
+typedef uint8_t __u8;
+typedef uint16_t __u16;
+typedef uint32_t __u32;
+typedef uint64_t __u64;
+typedef int32_t __s32;
+
+#ifndef likely
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+#define READ_ONCE(x) (*(const volatile typeof(x) *) &(x))
+#define WRITE_ONCE(x, val) (*(volatile typeof(x) *) &(x) = (val))
@@ -0,0 +1,284 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "control.h"
+
+#define XO_STATE_FILE "/sys/class/kxo/kxo/kxo_state"
+#define XO_ROLLOUTS_FILE "/sys/class/kxo/kxo/kxo_rollouts"
+#define XO_RAVE_FILE "/sys/class/kxo/kxo/kxo_rave"
+
+/* kxo_state reads and writes as "display resume end\n", each '0' or '1' */
+#define STATE_LEN 6
+
+int control_open(struct control *ctl, int dev_fd)
+{
+    struct kxo_state state;
+
+    ctl->fd = dev_fd;
+    ctl->state_fd = ctl->rollouts_fd = ctl->rave_fd = -1;
+    /* Commands only go through a game open for writing */
+    int flags = dev_fd >= 0 ? fcntl(dev_fd, F_GETFL) : -1;
+    if (flags >= 0 && (flags & O_ACCMODE) != O_RDONLY &&
+        ioctl(dev_fd, KXO_IOC_GET_STATE, &state) == 0)
+        return 0;
+
+    /* A module without the ioctl() interface: fall back on sysfs */
+    ctl->fd = -1;
+    ctl->state_fd = open(XO_STATE_FILE, O_RDWR);
+    if (ctl->state_fd < 0)
+        return -1;
+    ctl->rollouts_fd = open(XO_ROLLOUTS_FILE, O_RDWR);
+    ctl->rave_fd = open(XO_RAVE_FILE, O_RDWR);
+    return 0;
+}
+
+void control_close(struct control *ctl)
+{
+    if (ctl->state_fd >= 0)
+        close(ctl->state_fd);
+    if (ctl->rollouts_fd >= 0)
+        close(ctl->rollouts_fd);
+    if (ctl->rave_fd >= 0)
+        close(ctl->rave_fd);
+    ctl->fd = ctl->state_fd = ctl->rollouts_fd = ctl->rave_fd = -1;
+}
+
+static int sysfs_read(int fd, char *buf, size_t size)
+{
+    ssize_t len = pread(fd, buf, size - 1, 0);
+    if (len < 0)
+        return -1;
+    buf[len] = '\0';
+    return 0;
+}
+
+static int sysfs_write(int fd, const char *buf, size_t len)
+{
+    ssize_t n = pwrite(fd, buf, len, 0);
+    if (n < 0)
+        return -1;
+    if ((size_t) n != len) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+int control_get(struct control *ctl, struct kxo_state *state)
+{
+    char buf[32];
+
+    if (ctl->fd >= 0)
+        return ioctl(ctl->fd, KXO_IOC_GET_STATE, state);
+
+    memset(state, 0, sizeof(*state));
+    if (sysfs_read(ctl->state_fd, buf, sizeof(buf)))
+        return -1;
+    if (strlen(buf) < STATE_LEN - 1) {
+        errno = EIO;
+        return -1;
+    }
+    state->display = buf[0] == '1';
+    state->resume = buf[2] == '1';
+    state->end = buf[4] == '1';
+    if (ctl->rollouts_fd >= 0 &&
+        !sysfs_read(ctl->rollouts_fd, buf, sizeof(buf)))
+        state->rollouts = atoi(buf);
+    if (ctl->rave_fd >= 0 && !sysfs_read(ctl->rave_fd, buf, sizeof(buf)))
+        state->rave = atoi(buf);
+    return 0;
+}
+
+/* Write @value into the sysfs attribute @fd, ENOTSUP if it is missing */
+static int sysfs_write_int(int fd, int value)
+{
+    char buf[16];
+
+    if (fd < 0) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    int len = snprintf(buf, sizeof(buf), "%d\n", value);
+    return sysfs_write(fd, buf, len);
+}
+
+/* Read-modify-write kxo_state once for the whole batch, then kxo_rollouts and
+ * kxo_rave
+ */
+static int sysfs_apply(struct control *ctl, const struct kxo_cmd *cmds, int n)
+{
+    char state[32];
+    bool state_dirty = false;
+    int new_rollouts = 0, new_rave = -1;
+
+    if (sysfs_read(ctl->state_fd, state, sizeof(state)))
+        return -1;
+    if (strlen(state) < STATE_LEN - 1) {
+        errno = EIO;
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        char flag = '0' + cmds[i].arg;
+
+        switch (cmds[i].op) {
+        case KXO_CMD_DISPLAY:
+            state[0] = flag;
+            state_dirty = true;
+            break;
+        case KXO_CMD_RESUME:
+            state[2] = flag;
+            state_dirty = true;
+            break;
+        case KXO_CMD_END:
+            state[4] = flag;
+            state_dirty = true;
+            break;
+        case KXO_CMD_ROLLOUTS:
+            new_rollouts = cmds[i].arg;
+            break;
+        case KXO_CMD_RAVE:
+            new_rave = cmds[i].arg;
+            break;
+        }
+    }
+
+    if (state_dirty && sysfs_write(ctl->state_fd, state, STATE_LEN))
+        return -1;
+    if (new_rollouts && sysfs_write_int(ctl->rollouts_fd, new_rollouts))
+        return -1;
+    if (new_rave >= 0 && sysfs_write_int(ctl->rave_fd, new_rave))
+        return -1;
+    return 0;
+}
+
+int control_apply(struct control *ctl, const struct kxo_cmd *cmds, int n)
+{
+    if (n <= 0)
+        return 0;
+    if (n > KXO_MAX_CMDS) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (ctl->fd < 0)
+        return sysfs_apply(ctl, cmds, n);
+
+    struct kxo_cmd_batch batch = {
+        .n = n,
+        .cmds = (unsigned long) cmds,
+    };
+    return ioctl(ctl->fd, KXO_IOC_APPLY, &batch);
+}
+
+static const struct {
+    const char *name;
+    enum kxo_cmd_op op;
+    long min, max;
+} commands[] = {
+    {"display", KXO_CMD_DISPLAY, 0, 1},
+    {"resume", KXO_CMD_RESUME, 0, 1},
+    {"end", KXO_CMD_END, 0, 1},
+    {"rollouts", KXO_CMD_ROLLOUTS, 1, KXO_MAX_ROLLOUTS},
+    {"rave", KXO_CMD_RAVE, 0, KXO_MAX_RAVE},
+};
+
+/* Parse "name [value]", the value of a flag defaulting to 1 */
+static int parse_cmd(char *text, struct kxo_cmd *cmd)
+{
+    char *save, *name = strtok_r(text, " \t", &save);
+    char *value = strtok_r(NULL, " \t", &save);
+
+    if (!name || strtok_r(NULL, " \t", &save))
+        return -1;
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strcmp(name, commands[i].name))
+            continue;
+        char *end;
+        long arg = value ? strtol(value, &end, 10) : 1;
+        if ((value && *end) || arg < commands[i].min || arg > commands[i].max)
+            return -1;
+        if (!value && commands[i].max != 1)
+            return -1;
+        cmd->op = commands[i].op;
+        cmd->arg = arg;
+        return 0;
+    }
+    return -1;
+}
+
+int control_parse(const char *line, struct kxo_cmd *cmds)
+{
+    char buf[1024], *save, *text;
+    int n = 0;
+
+    snprintf(buf, sizeof(buf), "%s", line);
+    buf[strcspn(buf, "#\r\n")] = '\0';
+    for (text = strtok_r(buf, ";", &save); text;
+         text = strtok_r(NULL, ";", &save)) {
+        if (!text[strspn(text, " \t")])
+            continue;
+        if (n == KXO_MAX_CMDS || parse_cmd(text, &cmds[n]))
+            return -1;
+        n++;
+    }
+    return n;
+}
+
+/* Parse and apply one line of a script */
+static int run_line(struct control *ctl, const char *line, bool *ended)
+{
+    struct kxo_cmd cmds[KXO_MAX_CMDS];
+    int n = control_parse(line, cmds);
+
+    if (n < 0) {
+        fprintf(stderr, "control: invalid commands: %s\n", line);
+        return 0;
+    }
+    if (control_apply(ctl, cmds, n))
+        return -1;
+    for (int i = 0; i < n; i++) {
+        if (cmds[i].op == KXO_CMD_END && cmds[i].arg)
+            *ended = true;
+    }
+    return 0;
+}
+
+int control_script_run(struct control *ctl,
+                       struct control_script *script,
+                       bool *ended)
+{
+    for (;;) {
+        ssize_t len = read(script->fd, script->buf + script->len,
+                           sizeof(script->buf) - 1 - script->len);
+        if (len < 0)
+            return errno == EAGAIN || errno == EINTR ? 1 : -1;
+        script->len += len;
+        script->buf[script->len] = '\0';
+
+        char *line = script->buf, *nl;
+        while ((nl = strchr(line, '\n'))) {
+            *nl = '\0';
+            if (run_line(ctl, line, ended))
+                return -1;
+            line = nl + 1;
+        }
+        script->len -= line - script->buf;
+        memmove(script->buf, line, script->len);
+
+        if (len == 0) {
+            /* A last line without a newline */
+            if (script->len && run_line(ctl, script->buf, ended))
+                return -1;
+            script->len = 0;
+            return 0;
+        }
+        if (script->len == sizeof(script->buf) - 1) {
+            fprintf(stderr, "control: line too long, skipped\n");
+            script->len = 0;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+/* Long-lived control handle on the state of the module.
+ *
+ * The handle is opened once and commands go through it in batches: with the
+ * ioctl() interface of a game's fd when the module has one, otherwise with
+ * the sysfs attributes kept open and rewritten in place with pread() and
+ * pwrite(), a batch costing one read and one write of each attribute.
+ *
+ * Commands are also read from scripts, one batch per line, commands separated
+ * by ';':
+ *
+ *     display 0; rollouts 8; rave 300
+ *     resume 1
+ *     end
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "kxo_ioctl.h"
+
+/**
+ * struct control - Control handle
+ * @fd: game fd taking ioctl() commands, -1 when falling back on sysfs
+ * @state_fd: kxo_state in sysfs, -1 unless falling back on it
+ * @rollouts_fd: kxo_rollouts in sysfs, -1 unless falling back on it
+ * @rave_fd: kxo_rave in sysfs, -1 unless falling back on it
+ */
+struct control {
+    int fd;
+    int state_fd;
+    int rollouts_fd;
+    int rave_fd;
+};
+
+/**
+ * struct control_script - Script of commands being read
+ * @fd: file the script is read from
+ * @buf: start of the line being read
+ * @len: bytes in @buf
+ */
+struct control_script {
+    int fd;
+    char buf[1024];
+    size_t len;
+};
+
+/**
+ * control_open() - Open a control handle
+ * @ctl: handle to open
+ * @dev_fd: fd of an open game, used if it is open for writing and takes
+ *          ioctl() commands
+ *
+ * Return: 0 on success, -1 with errno set if the module cannot be controlled
+ */
+int control_open(struct control *ctl, int dev_fd);
+
+/**
+ * control_close() - Close a control handle
+ * @ctl: handle to close, which does not own the game fd
+ */
+void control_close(struct control *ctl);
+
+/**
+ * control_get() - Read the state of the module
+ * @ctl: control handle
+ * @state: filled in with the state
+ *
+ * Return: 0 on success, -1 with errno set on failure
+ */
+int control_get(struct control *ctl, struct kxo_state *state);
+
+/**
+ * control_apply() - Apply a batch of commands
+ * @ctl: control handle
+ * @cmds: commands, applied in order
+ * @n: number of commands, at most KXO_MAX_CMDS
+ *
+ * Return: 0 on success, -1 with errno set on failure
+ */
+int control_apply(struct control *ctl, const struct kxo_cmd *cmds, int n);
+
+/**
+ * control_parse() - Parse a line of commands
+ * @line: NUL-terminated commands separated by ';', '#' starting a comment
+ * @cmds: filled in with the commands, room for KXO_MAX_CMDS
+ *
+ * Return: number of commands, -1 on a syntax error
+ */
+int control_parse(const char *line, struct kxo_cmd *cmds);
+
+/**
+ * control_script_run() - Apply the complete lines read so far from a script
+ * @ctl: control handle
+ * @script: script to read from, possibly non-blocking
+ * @ended: set if the script applied an "end" command
+ *
+ * Every line is parsed and applied as a batch, lines with a syntax error
+ * being reported and skipped.
+ *
+ * Return: 1 while the script may have more lines, 0 at its end, -1 with errno
+ * set on a read or control failure
+ */
+int control_script_run(struct control *ctl,
+                       struct control_script *script,
+                       bool *ended);
+
+#endif /* CONTROL_H */
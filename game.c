@@ -1,29 +1,20 @@
-#include <linux/slab.h>
-
+#include "bitboard.h"
 #include "game.h"
+#include "game_tables.h"
 
-
-const line_t lines[4] = {
-    {1, 0, 0, 0, BOARD_SIZE - GOAL + 1, BOARD_SIZE},             // COL
-    {0, 1, 0, 0, BOARD_SIZE, BOARD_SIZE - GOAL + 1},             // ROW
-    {1, 1, 0, 0, BOARD_SIZE - GOAL + 1, BOARD_SIZE - GOAL + 1},  // PRIMARY
-    {1, -1, 0, GOAL - 1, BOARD_SIZE - GOAL + 1, BOARD_SIZE},     // SECONDARY
-};
-
-static char check_line_segment_win(const char *t, int i, int j, line_t line)
+static char check_segment_win(const char *t, int s)
 {
-    char last = t[GET_INDEX(i, j)];
+    char last = t[segment_squares[s][0]];
     if (last == ' ')
         return ' ';
     for (int k = 1; k < GOAL; k++) {
-        if (last != t[GET_INDEX(i + k * line.i_shift, j + k * line.j_shift)])
+        if (last != t[segment_squares[s][k]])
             return ' ';
     }
 
 #if !ALLOW_EXCEED
-    if (last == LOOKUP(t, i - line.i_shift, j - line.j_shift, ' ') ||
-        last ==
-            LOOKUP(t, i + GOAL * line.i_shift, j + GOAL * line.j_shift, ' '))
+    if ((segment_guards[s][0] >= 0 && last == t[segment_guards[s][0]]) ||
+        (segment_guards[s][1] >= 0 && last == t[segment_guards[s][1]]))
         return ' ';
 #endif
     return last;
@@ -31,15 +22,14 @@ static char check_line_segment_win(const char *t, int i, int j, line_t line)
 
 char check_win(const char *t)
 {
-    for (int i_line = 0; i_line < 4; ++i_line) {
-        line_t line = lines[i_line];
-        for (int i = line.i_lower_bound; i < line.i_upper_bound; ++i) {
-            for (int j = line.j_lower_bound; j < line.j_upper_bound; ++j) {
-                char win = check_line_segment_win(t, i, j, line);
-                if (win != ' ')
-                    return win;
-            }
-        }
+    /* With the segment table known at compile time, fully unrolling turns
+     * this into straight-line code with constant offsets.
+     */
+    UNROLL_SEGMENTS
+    for (int s = 0; s < N_SEGMENTS; s++) {
+        char win = check_segment_win(t, s);
+        if (win != ' ')
+            return win;
     }
     for (int i = 0; i < N_GRIDS; i++)
         if (t[i] == ' ')
@@ -47,6 +37,18 @@ char check_win(const char *t)
     return 'D';
 }
 
+char check_win_bitboard(const struct bitboard *b)
+{
+    UNROLL_SEGMENTS
+    for (int s = 0; s < N_SEGMENTS; s++) {
+        if (segment_won(b->o, s))
+            return 'O';
+        if (segment_won(b->x, s))
+            return 'X';
+    }
+    return bitboard_empty(b) ? ' ' : 'D';
+}
+
 fixed_point_t calculate_win_value(char win, char player)
 {
     if (win == player)
@@ -56,14 +58,11 @@ fixed_point_t calculate_win_value(char win, char player)
     return 1U << (FIXED_SCALE_BITS - 1);
 }
 
-int *available_moves(const char *table)
+int available_moves(const char *table, int *moves)
 {
-    int *moves = kzalloc(N_GRIDS * sizeof(int), GFP_KERNEL);
     int m = 0;
     for (int i = 0; i < N_GRIDS; i++)
         if (table[i] == ' ')
             moves[m++] = i;
-    if (m < N_GRIDS)
-        moves[m] = -1;
-    return moves;
+    return m;
 }
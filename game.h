@@ -1,9 +1,29 @@
 #pragma once
 
+/* The board can be chosen at build time, e.g. "make BOARD_SIZE=5 GOAL=4".
+ * The engines then use the tables of game_tables.h, which are generated for
+ * that exact configuration by scripts/gen-tables.c.
+ */
+#ifndef BOARD_SIZE
 #define BOARD_SIZE 4
+#endif
+#ifndef GOAL
 #define GOAL 3
+#endif
+#ifndef ALLOW_EXCEED
 #define ALLOW_EXCEED 1
+#endif
 #define N_GRIDS (BOARD_SIZE * BOARD_SIZE)
+
+#if BOARD_SIZE > 8 || GOAL > BOARD_SIZE
+#error "the engines support boards of up to 8x8 with GOAL <= BOARD_SIZE"
+#endif
+/* get_score() scores a won segment 10^(GOAL - 1), which must stay well inside
+ * the window negamax searches within, NEGAMAX_WINDOW in negamax.c
+ */
+#if GOAL > 5
+#error "GOAL > 5 overflows the +-100000 score window of negamax"
+#endif
 #define GET_INDEX(i, j) ((i) * (BOARD_SIZE) + (j))
 #define GET_COL(x) ((x) % BOARD_SIZE)
 #define GET_ROW(x) ((x) / BOARD_SIZE)
@@ -12,11 +32,6 @@
     for (int i = 0; i < N_GRIDS; i++) \
         if (table[i] == ' ')
 
-typedef struct {
-    int i_shift, j_shift;
-    int i_lower_bound, j_lower_bound, i_upper_bound, j_upper_bound;
-} line_t;
-
 /* Self-defined fixed-point type, using last 10 bits as fractional bits,
  * starting from lsb */
 #define FIXED_SCALE_BITS 8
@@ -32,8 +47,9 @@ typedef unsigned fixed_point_t;
     ((BOARD_SIZE * (BOARD_SIZE + 1) << 1) + (BOARD_SIZE * BOARD_SIZE) + \
      ((BOARD_SIZE << 1) + 1) + 1)
 
-extern const line_t lines[4];
-
-int *available_moves(const char *table);
+/* Store the empty squares of @table into @moves, which must have room for
+ * N_GRIDS entries, and return how many there are.
+ */
+int available_moves(const char *table, int *moves);
 char check_win(const char *t);
 fixed_point_t calculate_win_value(char win, char player);
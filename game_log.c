@@ -0,0 +1,184 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "game_log.h"
+
+/* Room for a whole block of games and its index */
+#define LOG_BUF_SIZE ((LOG_INDEX_INTERVAL + 1) * LOG_ENTRY_SIZE)
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int game_log_flush(struct game_log *log)
+{
+    int ret = write_all(log->fd, log->buf, log->used);
+    log->used = 0;
+    return ret;
+}
+
+/* Reserve the next entry in the buffer, writing the buffer out if full */
+static void *game_log_entry(struct game_log *log)
+{
+    if (log->used + LOG_ENTRY_SIZE > LOG_BUF_SIZE && game_log_flush(log))
+        return NULL;
+
+    void *entry = log->buf + log->used;
+    memset(entry, 0, LOG_ENTRY_SIZE);
+    log->used += LOG_ENTRY_SIZE;
+    return entry;
+}
+
+static int game_log_index(struct game_log *log)
+{
+    void *entry = game_log_entry(log);
+    if (!entry)
+        return -1;
+
+    log->block.mark = LOG_INDEX_MARK;
+    log->block.games = log->games - log->block.n_games;
+    memcpy(entry, &log->block, sizeof(log->block));
+    memset(&log->block, 0, sizeof(log->block));
+    return 0;
+}
+
+int game_log_open(struct game_log *log, const char *path)
+{
+    struct log_header header = {
+        .magic = LOG_MAGIC,
+        .version = LOG_VERSION,
+        .board_size = BOARD_SIZE,
+        .goal = GOAL,
+        .allow_exceed = ALLOW_EXCEED,
+        .move_bits = RECORD_MOVE_BITS,
+        .entry_size = LOG_ENTRY_SIZE,
+        .index_interval = LOG_INDEX_INTERVAL,
+    };
+
+    memset(log, 0, sizeof(*log));
+    log->buf = malloc(LOG_BUF_SIZE);
+    if (!log->buf)
+        return -1;
+    log->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log->fd < 0 || write_all(log->fd, (char *) &header, sizeof(header))) {
+        int err = errno;
+        if (log->fd >= 0)
+            close(log->fd);
+        free(log->buf);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+int game_log_append(struct game_log *log, const struct record *record)
+{
+    void *entry = game_log_entry(log);
+    if (!entry)
+        return -1;
+    memcpy(entry, record, sizeof(*record));
+
+    log->games++;
+    log->block.n_games++;
+    log->block.o_wins += record->winner == 'O';
+    log->block.x_wins += record->winner == 'X';
+    /* Write every block out once indexed, so a crash loses at most one */
+    if (log->block.n_games == LOG_INDEX_INTERVAL)
+        return game_log_index(log) || game_log_flush(log) ? -1 : 0;
+    return 0;
+}
+
+int game_log_close(struct game_log *log)
+{
+    int ret = 0;
+
+    if (log->block.n_games)
+        ret = game_log_index(log);
+    if (game_log_flush(log))
+        ret = -1;
+    if (close(log->fd))
+        ret = -1;
+    free(log->buf);
+    return ret;
+}
+
+static int check_header(const struct log_header *h, const char *path)
+{
+    if (memcmp(h->magic, LOG_MAGIC, sizeof(h->magic))) {
+        fprintf(stderr, "%s: not a kxo game log\n", path);
+        return -1;
+    }
+    if (h->version != LOG_VERSION || h->entry_size != LOG_ENTRY_SIZE ||
+        h->move_bits != RECORD_MOVE_BITS ||
+        h->index_interval != LOG_INDEX_INTERVAL) {
+        fprintf(stderr, "%s: unsupported log version %d\n", path, h->version);
+        return -1;
+    }
+    if (h->board_size != BOARD_SIZE || h->goal != GOAL ||
+        h->allow_exceed != ALLOW_EXCEED) {
+        fprintf(stderr,
+                "%s: log of %dx%d games, GOAL %d, ALLOW_EXCEED %d: rebuild "
+                "with the same board configuration\n",
+                path, h->board_size, h->board_size, h->goal, h->allow_exceed);
+        return -1;
+    }
+    return 0;
+}
+
+int game_log_map(struct game_log_view *view, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    view->size = st.st_size;
+    if (view->size < sizeof(struct log_header)) {
+        fprintf(stderr, "%s: not a kxo game log\n", path);
+        close(fd);
+        return -1;
+    }
+    view->map = mmap(NULL, view->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view->map == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    if (check_header((const struct log_header *) view->map, path)) {
+        munmap((void *) view->map, view->size);
+        return -1;
+    }
+
+    size_t body = view->size - sizeof(struct log_header);
+    view->entries = view->map + sizeof(struct log_header);
+    view->n_entries = body / LOG_ENTRY_SIZE;
+    if (body % LOG_ENTRY_SIZE)
+        fprintf(stderr, "%s: ignoring a truncated entry at the end\n", path);
+    madvise((void *) view->map, view->size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void game_log_unmap(struct game_log_view *view)
+{
+    munmap((void *) view->map, view->size);
+}
@@ -0,0 +1,169 @@
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+/* Append-only binary log of finished games.
+ *
+ * A log is a struct log_header followed by fixed-size entries of
+ * LOG_ENTRY_SIZE bytes. Most entries hold one game as a struct record. After
+ * every LOG_INDEX_INTERVAL games, and when the log is closed, a struct
+ * log_index entry sums up the block of games before it. The index entries can
+ * be told apart from games by their first byte, so a reader may use them to
+ * skip whole blocks, and a log cut short by a crash stays readable up to its
+ * last complete entry.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "record_store.h"
+
+#define LOG_MAGIC "KXOLOG\0"
+#define LOG_VERSION 1
+
+/* Games per indexed block */
+#define LOG_INDEX_INTERVAL 4096
+
+/* Records padded to a multiple of 8 bytes, large enough for an index */
+#define LOG_ENTRY_SIZE                                             \
+    ((sizeof(struct record) + 7) / 8 * 8 < sizeof(struct log_index) \
+         ? sizeof(struct log_index)                                 \
+         : (sizeof(struct record) + 7) / 8 * 8)
+
+/* First byte of an index entry, where a record keeps its length */
+#define LOG_INDEX_MARK 0xff
+
+/**
+ * struct log_header - Start of every log
+ * @magic: LOG_MAGIC
+ * @version: LOG_VERSION
+ * @board_size: BOARD_SIZE the games were played with
+ * @goal: GOAL the games were played with
+ * @allow_exceed: ALLOW_EXCEED the games were played with
+ * @move_bits: RECORD_MOVE_BITS of the records
+ * @entry_size: LOG_ENTRY_SIZE
+ * @index_interval: LOG_INDEX_INTERVAL
+ */
+struct log_header {
+    char magic[8];
+    uint16_t version;
+    uint8_t board_size;
+    uint8_t goal;
+    uint8_t allow_exceed;
+    uint8_t move_bits;
+    uint16_t entry_size;
+    uint32_t index_interval;
+    uint32_t reserved[3];
+};
+
+/**
+ * struct log_index - Summary of the games since the previous index
+ * @mark: LOG_INDEX_MARK
+ * @n_games: games in the block
+ * @o_wins: games of the block won by O
+ * @x_wins: games of the block won by X
+ * @games: games logged before the block
+ */
+struct log_index {
+    uint8_t mark;
+    uint8_t reserved;
+    uint16_t n_games;
+    uint16_t o_wins;
+    uint16_t x_wins;
+    uint64_t games;
+};
+
+/**
+ * struct game_log - Log being written
+ * @fd: file the log is appended to
+ * @buf: entries not written out yet
+ * @used: bytes used in @buf
+ * @games: games logged so far
+ * @block: summary of the games since the last index entry
+ */
+struct game_log {
+    int fd;
+    char *buf;
+    size_t used;
+    uint64_t games;
+    struct log_index block;
+};
+
+/**
+ * struct game_log_view - Log mapped into memory for reading
+ * @map: the whole file
+ * @size: size of @map
+ * @entries: first entry, right after the header
+ * @n_entries: complete entries in the log
+ */
+struct game_log_view {
+    const char *map;
+    size_t size;
+    const char *entries;
+    size_t n_entries;
+};
+
+/**
+ * game_log_open() - Create a log, or truncate an existing one
+ * @log: log to initialize
+ * @path: file to write the log into
+ *
+ * Return: 0 on success, -1 with errno set on failure
+ */
+int game_log_open(struct game_log *log, const char *path);
+
+/**
+ * game_log_append() - Append a finished game
+ * @log: log to append to
+ * @record: the game
+ *
+ * Entries are buffered and written out a block at a time.
+ *
+ * Return: 0 on success, -1 with errno set on failure
+ */
+int game_log_append(struct game_log *log, const struct record *record);
+
+/**
+ * game_log_close() - Index the last block, flush and close the log
+ * @log: log to close
+ *
+ * Return: 0 on success, -1 with errno set on failure
+ */
+int game_log_close(struct game_log *log);
+
+/**
+ * game_log_map() - Map a log written with the same board configuration
+ * @view: view to fill in
+ * @path: log to map
+ *
+ * A truncated entry at the end of the log, left by a crash, is ignored.
+ *
+ * Return: 0 on success, -1 after printing why the log cannot be read
+ */
+int game_log_map(struct game_log_view *view, const char *path);
+
+/**
+ * game_log_unmap() - Unmap a log mapped with game_log_map()
+ * @view: view to release
+ */
+void game_log_unmap(struct game_log_view *view);
+
+/**
+ * log_entry_at() - @i-th entry of a mapped log
+ */
+static inline const void *log_entry_at(const struct game_log_view *view,
+                                       size_t i)
+{
+    return view->entries + i * LOG_ENTRY_SIZE;
+}
+
+/**
+ * log_entry_is_index() - Tell an index entry from a game record
+ * @entry: start of a LOG_ENTRY_SIZE entry
+ */
+static inline bool log_entry_is_index(const void *entry)
+{
+    return *(const uint8_t *) entry == LOG_INDEX_MARK;
+}
+
+#endif /* GAME_LOG_H */
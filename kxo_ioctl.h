@@ -0,0 +1,235 @@
+#ifndef KXO_IOCTL_H
+#define KXO_IOCTL_H
+
+/* ioctl() interface of /dev/kxo, shared by the module and xo-user.
+ *
+ * Any open game can be used as a control handle for the state of the whole
+ * module, which kxo_state, kxo_rollouts and kxo_rave in sysfs also expose.
+ * Commands are applied in batches: a batch is checked as a whole before any of
+ * its commands takes effect, then applied at once.
+ *
+ * One side of a game can also be played from userspace instead of by the
+ * engines of the module: after KXO_IOC_SET_EXTERNAL on a file opened for
+ * writing, the game waits on that side's turns for its move to be written
+ * into the file as an int square index. poll() reports EPOLLOUT while a move
+ * is awaited, and write() blocks until then unless the file is non-blocking.
+ * A move to an occupied or out-of-board square fails with EINVAL.
+ *
+ * KXO_IOC_ANALYZE runs the engines on a batch of positions, independently of
+ * the games, and fills in the best move of each. The positions are spread
+ * over the module's workqueue: MCTS searches run in parallel, while negamax
+ * searches one position at a time, with tables apart from those of the
+ * games. It needs the file open for writing, as KXO_IOC_SUBMIT does.
+ *
+ * Positions can also be analyzed asynchronously, as jobs tagged with ids of
+ * the caller's choice: KXO_IOC_SUBMIT queues jobs and returns at once, the
+ * eventfd registered with KXO_IOC_SET_EVENTFD, if any, is signalled once per
+ * completed job, and KXO_IOC_REAP fetches completed jobs in batches. Jobs
+ * belong to the file they were submitted on, which waits for the running ones
+ * when closed.
+ *
+ * The current board of a game is also published in a struct kxo_snapshot at
+ * the start of a read-only page, mapped with mmap() of the game's file at
+ * offset 0. It is rewritten on every move and at the end of every game, the
+ * writer making @seq odd for the time of the update. A reader samples it
+ * without any system call, and without taking packages from other readers:
+ *
+ *     do {
+ *         while ((seq = load_acquire(&snap->seq)) & 1)
+ *             ;
+ *         copy = *snap;
+ *         read barrier;
+ *     } while (load(&snap->seq) != seq);
+ */
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define KXO_IOC_MAGIC 'x'
+
+/* Most commands in a batch */
+#define KXO_MAX_CMDS 64
+
+/**
+ * struct kxo_state - State of the module
+ * @display: boards are sent to the games' readers
+ * @resume: games are resumed
+ * @end: games stop at their next end instead of starting over
+ * @rollouts: rollouts played by MCTS from every new leaf
+ * @rave: RAVE equivalence parameter of MCTS, 0 for plain UCT
+ */
+struct kxo_state {
+    __u8 display;
+    __u8 resume;
+    __u8 end;
+    __u8 reserved;
+    __u32 rollouts;
+    __u32 rave;
+};
+
+/* Most MCTS rollouts per leaf, the range of KXO_CMD_ROLLOUTS being 1 to it */
+#define KXO_MAX_ROLLOUTS 64
+
+/* Largest RAVE equivalence parameter, KXO_CMD_RAVE ranging from 0 to it */
+#define KXO_MAX_RAVE 100000
+
+/* Field of struct kxo_state a command sets */
+enum kxo_cmd_op {
+    KXO_CMD_DISPLAY,  /* 0 or 1 */
+    KXO_CMD_RESUME,   /* 0 or 1 */
+    KXO_CMD_END,      /* 0 or 1 */
+    KXO_CMD_ROLLOUTS, /* 1 to KXO_MAX_ROLLOUTS */
+    KXO_CMD_RAVE,     /* 0 to KXO_MAX_RAVE */
+};
+
+/**
+ * struct kxo_cmd - One change of the state
+ * @op: enum kxo_cmd_op
+ * @arg: new value
+ */
+struct kxo_cmd {
+    __u32 op;
+    __u32 arg;
+};
+
+/**
+ * struct kxo_cmd_batch - Commands to apply in one call
+ * @n: number of commands, at most KXO_MAX_CMDS
+ * @cmds: user pointer to @n struct kxo_cmd
+ */
+struct kxo_cmd_batch {
+    __u32 n;
+    __u32 reserved;
+    __u64 cmds;
+};
+
+/**
+ * struct kxo_board - Board of a game
+ * @size: BOARD_SIZE of the module
+ * @turn: side to move, 'O' or 'X'
+ * @awaiting: the game waits for the move of its external side
+ * @table: the @size * @size squares, row by row, ' ', 'O' or 'X'
+ */
+struct kxo_board {
+    __u8 size;
+    char turn;
+    __u8 awaiting;
+    __u8 reserved[5];
+    char table[64];
+};
+
+/**
+ * struct kxo_snapshot - Board of a game, mapped from its file
+ * @seq: update count, odd while an update is in progress
+ * @size: BOARD_SIZE of the module
+ * @turn: side to move, 'O' or 'X'
+ * @result: ' ' while the game is played, then 'O', 'X' or 'D' for a draw
+ * @reserved: zero
+ * @last_move: square of the last move, -1 before the first
+ * @moves: moves played in the game
+ * @games: games completed on the file
+ * @ts: ktime_get_ns() of the update, CLOCK_MONOTONIC
+ * @table: the @size * @size squares, row by row, ' ', 'O' or 'X'
+ */
+struct kxo_snapshot {
+    __u32 seq;
+    __u8 size;
+    char turn;
+    char result;
+    __u8 reserved;
+    __s32 last_move;
+    __u32 moves;
+    __u64 games;
+    __u64 ts;
+    char table[64];
+};
+
+/* Most positions in a batch */
+#define KXO_MAX_POSITIONS 4096
+
+/* Largest budgets of struct kxo_position. The module bounds both further for
+ * its board size, the memory of an MCTS tree and the time of a negamax search
+ * growing with it.
+ */
+#define KXO_MAX_ITERATIONS 1000000
+#define KXO_MAX_DEPTH 16
+
+enum kxo_engine {
+    KXO_ENGINE_MCTS,
+    KXO_ENGINE_NEGAMAX,
+};
+
+/**
+ * struct kxo_position - Position to analyze, and the result
+ * @table: in: the BOARD_SIZE * BOARD_SIZE squares, ' ', 'O' or 'X'
+ * @player: in: side to move, 'O' or 'X'
+ * @engine: in: enum kxo_engine
+ * @budget: in: MCTS iterations or negamax depth, an even number of plies
+ *          from 2, 0 for the module's default
+ * @move: out: best move, -1 if the game is over
+ * @score: out: negamax score, or MCTS average value of @move for @player in
+ *         thousandths, 1000 being a certain win
+ */
+struct kxo_position {
+    char table[64];
+    char player;
+    __u8 engine;
+    __u16 reserved;
+    __u32 budget;
+    __s32 move;
+    __s32 score;
+};
+
+/**
+ * struct kxo_analysis - Batch of positions
+ * @n: number of positions, at most KXO_MAX_POSITIONS
+ * @positions: user pointer to @n struct kxo_position, updated in place
+ */
+struct kxo_analysis {
+    __u32 n;
+    __u32 reserved;
+    __u64 positions;
+};
+
+/* Most jobs submitted and not reaped yet, per file */
+#define KXO_MAX_JOBS 4096
+
+/**
+ * struct kxo_job - Asynchronous analysis of a position
+ * @id: tag of the caller's choice, returned along with the result
+ * @pos: position to analyze, with the result once reaped
+ */
+struct kxo_job {
+    __u64 id;
+    struct kxo_position pos;
+};
+
+/**
+ * struct kxo_jobs - Jobs to submit, or room for completed jobs to reap
+ * @n: number of jobs, at most KXO_MAX_JOBS
+ * @jobs: user pointer to @n struct kxo_job
+ */
+struct kxo_jobs {
+    __u32 n;
+    __u32 reserved;
+    __u64 jobs;
+};
+
+#define KXO_IOC_GET_STATE _IOR(KXO_IOC_MAGIC, 1, struct kxo_state)
+/* Changes the state of the whole module: EPERM unless open for writing */
+#define KXO_IOC_APPLY _IOW(KXO_IOC_MAGIC, 2, struct kxo_cmd_batch)
+/* Argument: 'O' or 'X' for the side to play from userspace, ' ' for none */
+#define KXO_IOC_SET_EXTERNAL _IO(KXO_IOC_MAGIC, 3)
+#define KXO_IOC_GET_BOARD _IOR(KXO_IOC_MAGIC, 4, struct kxo_board)
+/* EPERM unless open for writing, as KXO_IOC_SUBMIT */
+#define KXO_IOC_ANALYZE _IOW(KXO_IOC_MAGIC, 5, struct kxo_analysis)
+/* Return the number of jobs queued, fewer than asked if KXO_MAX_JOBS would
+ * be exceeded, failing with EAGAIN if none could be
+ */
+#define KXO_IOC_SUBMIT _IOW(KXO_IOC_MAGIC, 6, struct kxo_jobs)
+/* Return the number of completed jobs copied out, 0 if none has completed */
+#define KXO_IOC_REAP _IOW(KXO_IOC_MAGIC, 7, struct kxo_jobs)
+/* Argument: eventfd to signal as jobs complete, -1 for none */
+#define KXO_IOC_SET_EVENTFD _IO(KXO_IOC_MAGIC, 8)
+
+#endif /* KXO_IOCTL_H */
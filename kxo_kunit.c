@@ -0,0 +1,179 @@
+/* KUnit tests and in-kernel timings for the kxo game engines
+ *
+ * Built as kxo-test.ko by "make kunit". Besides checking a few known
+ * positions, each case reports the time per call measured in kernel context,
+ * i.e. including kzalloc(GFP_KERNEL) and preemption, to be compared with the
+ * userspace numbers of xo-bench.
+ */
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/string.h>
+
+#include "game.h"
+#include "mcts.h"
+#include "negamax.h"
+#include "zobrist.h"
+
+MODULE_LICENSE("Dual MIT/GPL");
+MODULE_AUTHOR("National Cheng Kung University, Taiwan");
+MODULE_DESCRIPTION("KUnit tests for the kxo game engines");
+
+#define CHECK_WIN_CALLS 100000
+#define SEARCH_CALLS 3
+#define ZOBRIST_KEYS 10000
+
+static void place(char *table, int row, int col, char player)
+{
+    table[GET_INDEX(row, col)] = player;
+}
+
+/* O to move, and playing (0, GOAL - 1) completes the top row */
+static int o_wins_in_one(char *table)
+{
+    memset(table, ' ', N_GRIDS);
+    for (int k = 0; k < GOAL - 1; k++) {
+        place(table, 0, k, 'O');
+        place(table, 1, k, 'X');
+    }
+    return GET_INDEX(0, GOAL - 1);
+}
+
+static void report_time(struct kunit *test,
+                        const char *what,
+                        ktime_t start,
+                        unsigned long calls)
+{
+    s64 nsecs = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+    kunit_info(test, "%s: %lld ns/call over %lu calls\n", what,
+               div64_s64(nsecs, calls), calls);
+}
+
+static void kxo_check_win_test(struct kunit *test)
+{
+    char table[N_GRIDS];
+
+    memset(table, ' ', N_GRIDS);
+    KUNIT_EXPECT_EQ(test, check_win(table), ' ');
+
+    for (int k = 0; k < GOAL; k++)
+        place(table, 0, k, 'X');
+    KUNIT_EXPECT_EQ(test, check_win(table), 'X');
+
+    memset(table, ' ', N_GRIDS);
+    for (int k = 0; k < GOAL; k++)
+        place(table, k, 1, 'O');
+    KUNIT_EXPECT_EQ(test, check_win(table), 'O');
+
+    memset(table, ' ', N_GRIDS);
+    for (int k = 0; k < GOAL; k++)
+        place(table, k, k, 'O');
+    KUNIT_EXPECT_EQ(test, check_win(table), 'O');
+
+    memset(table, ' ', N_GRIDS);
+    for (int k = 0; k < GOAL; k++)
+        place(table, k, GOAL - 1 - k, 'X');
+    KUNIT_EXPECT_EQ(test, check_win(table), 'X');
+
+    /* Rows of "OOXX..." shifted by two squares on every other row */
+    for (int i = 0; i < BOARD_SIZE; i++)
+        for (int j = 0; j < BOARD_SIZE; j++)
+            place(table, i, j, ((j >> 1) + i) & 1 ? 'X' : 'O');
+    KUNIT_EXPECT_EQ(test, check_win(table), 'D');
+
+    o_wins_in_one(table);
+    ktime_t start = ktime_get();
+    for (int i = 0; i < CHECK_WIN_CALLS; i++)
+        KUNIT_ASSERT_EQ(test, check_win(table), ' ');
+    report_time(test, "check_win", start, CHECK_WIN_CALLS);
+}
+
+static void kxo_mcts_test(struct kunit *test)
+{
+    char table[N_GRIDS];
+    int win = o_wins_in_one(table);
+
+    mcts_init();
+
+    ktime_t start = ktime_get();
+    for (int i = 0; i < SEARCH_CALLS; i++)
+        KUNIT_EXPECT_EQ(test, mcts(table, 'O'), win);
+    report_time(test, "mcts", start, SEARCH_CALLS);
+    kunit_info(test, "mcts: %d nodes/move\n", mcts_nr_active_nodes());
+}
+
+static void kxo_negamax_test(struct kunit *test)
+{
+    char table[N_GRIDS];
+
+    o_wins_in_one(table);
+
+    unsigned long nodes = negamax_nr_nodes();
+    ktime_t start = ktime_get();
+    for (int i = 0; i < SEARCH_CALLS; i++) {
+        int move = negamax_predict(table, 'O').move;
+        KUNIT_ASSERT_GE(test, move, 0);
+        KUNIT_ASSERT_LT(test, move, N_GRIDS);
+        KUNIT_EXPECT_EQ(test, table[move], ' ');
+    }
+    report_time(test, "negamax_predict", start, SEARCH_CALLS);
+    kunit_info(test, "negamax_predict: %lu nodes/call\n",
+               (negamax_nr_nodes() - nodes) / SEARCH_CALLS);
+}
+
+static void kxo_zobrist_test(struct kunit *test)
+{
+    struct hlist_head *table = zobrist_alloc();
+
+    KUNIT_ASSERT_NOT_NULL(test, table);
+    KUNIT_EXPECT_PTR_EQ(test, zobrist_get(table, zobrist_table[0][0]), NULL);
+
+    ktime_t start = ktime_get();
+    for (int i = 0; i < ZOBRIST_KEYS; i++)
+        zobrist_put(table, zobrist_table[0][0] + i, i, i % N_GRIDS);
+    report_time(test, "zobrist_put", start, ZOBRIST_KEYS);
+
+    start = ktime_get();
+    for (int i = 0; i < ZOBRIST_KEYS; i++) {
+        const zobrist_entry_t *entry =
+            zobrist_get(table, zobrist_table[0][0] + i);
+        KUNIT_ASSERT_NOT_ERR_OR_NULL(test, entry);
+        KUNIT_EXPECT_EQ(test, entry->score, i);
+        KUNIT_EXPECT_EQ(test, entry->move, i % N_GRIDS);
+    }
+    report_time(test, "zobrist_get", start, ZOBRIST_KEYS);
+
+    start = ktime_get();
+    zobrist_clear(table);
+    report_time(test, "zobrist_clear", start, 1);
+    KUNIT_EXPECT_PTR_EQ(test, zobrist_get(table, zobrist_table[0][0]), NULL);
+    zobrist_free(table);
+}
+
+/* negamax_init() also sets up the zobrist keys and the shared hash table, which
+ * is never released, so only do it once.
+ */
+static int kxo_engine_suite_init(struct kunit_suite *suite)
+{
+    negamax_init();
+    return 0;
+}
+
+static struct kunit_case kxo_engine_cases[] = {
+    KUNIT_CASE(kxo_check_win_test),
+    KUNIT_CASE(kxo_mcts_test),
+    KUNIT_CASE(kxo_negamax_test),
+    KUNIT_CASE(kxo_zobrist_test),
+    {},
+};
+
+static struct kunit_suite kxo_engine_suite = {
+    .name = "kxo-engine",
+    .suite_init = kxo_engine_suite_init,
+    .test_cases = kxo_engine_cases,
+};
+
+kunit_test_suite(kxo_engine_suite);
@@ -3,7 +3,15 @@
 
 struct package {
     char val;
+    /* Result of check_win() carried by the package ending a game */
+    char result;
+    /* Number of the game within its file, wrapping around. A reader which
+     * missed the package ending a game tells the next one by it.
+     */
+    unsigned short game;
     int move;
+    /* ktime_get_ns() when the package was queued, CLOCK_MONOTONIC */
+    unsigned long long ts;
 };
 
 #define PKG_PUT_AI(pkg, c) (READ_ONCE(pkg.val) & 0x80) | c
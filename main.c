@@ -1,17 +1,29 @@
 /* kxo: A Tic-Tac-Toe Game Engine implemented as Linux kernel module */
 
 #include <linux/cdev.h>
-#include <linux/circ_buf.h>
+#include <linux/completion.h>
+#include <linux/eventfd.h>
 #include <linux/interrupt.h>
 #include <linux/kfifo.h>
+#include <linux/memcontrol.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/proc_fs.h>
+#include <linux/random.h>
+#include <linux/rculist.h>
+#include <linux/refcount.h>
+#include <linux/sched/mm.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
+#include <linux/uaccess.h>
 #include <linux/version.h>
-#include <linux/vmalloc.h>
 #include <linux/workqueue.h>
 
 #include "game.h"
+#include "kxo_ioctl.h"
 #include "kxo_pkg.h"
 #include "mcts.h"
 #include "negamax.h"
@@ -20,13 +32,6 @@ MODULE_LICENSE("Dual MIT/GPL");
 MODULE_AUTHOR("National Cheng Kung University, Taiwan");
 MODULE_DESCRIPTION("In-kernel Tic-Tac-Toe game engine");
 
-/* Macro DECLARE_TASKLET_OLD exists for compatibiity.
- * See https://lwn.net/Articles/830964/
- */
-#ifndef DECLARE_TASKLET_OLD
-#define DECLARE_TASKLET_OLD(arg1, arg2) DECLARE_TASKLET(arg1, arg2, 0L)
-#endif
-
 #define DEV_NAME "kxo"
 
 #define NR_KMLDRV 1
@@ -43,10 +48,6 @@ struct kxo_attr {
 };
 
 static struct kxo_attr attr_obj;
-static struct package pkg_obj = {
-    .val = ' ',
-    .move = -1,
-};
 
 static ssize_t kxo_state_show(struct device *dev,
                               struct device_attribute *attr,
@@ -73,60 +74,278 @@ static ssize_t kxo_state_store(struct device *dev,
 
 static DEVICE_ATTR_RW(kxo_state);
 
-/* Data produced by the simulated device */
+/* Search parameters of the MCTS player, rollouts and RAVE tunable through
+ * sysfs
+ */
+static struct mcts_config mcts_config = {
+    .iterations = ITERATIONS,
+    .rollouts = 1,
+};
+
+static ssize_t kxo_rollouts_show(struct device *dev,
+                                 struct device_attribute *attr,
+                                 char *buf)
+{
+    return snprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(mcts_config.rollouts));
+}
+
+static ssize_t kxo_rollouts_store(struct device *dev,
+                                  struct device_attribute *attr,
+                                  const char *buf,
+                                  size_t count)
+{
+    int rollouts;
+    int ret = kstrtoint(buf, 10, &rollouts);
+
+    if (ret)
+        return ret;
+    if (rollouts < 1 || rollouts > KXO_MAX_ROLLOUTS)
+        return -EINVAL;
+    WRITE_ONCE(mcts_config.rollouts, rollouts);
+    return count;
+}
+
+static DEVICE_ATTR_RW(kxo_rollouts);
+
+static ssize_t kxo_rave_show(struct device *dev,
+                             struct device_attribute *attr,
+                             char *buf)
+{
+    return snprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(mcts_config.rave));
+}
+
+/* 0 selects plain UCT */
+static ssize_t kxo_rave_store(struct device *dev,
+                              struct device_attribute *attr,
+                              const char *buf,
+                              size_t count)
+{
+    int rave;
+    int ret = kstrtoint(buf, 10, &rave);
+
+    if (ret)
+        return ret;
+    if (rave < 0 || rave > KXO_MAX_RAVE)
+        return -EINVAL;
+    WRITE_ONCE(mcts_config.rave, rave);
+    return count;
+}
+
+static DEVICE_ATTR_RW(kxo_rave);
+
+/* Packages dropped because the kfifo of their game was full */
+static atomic_long_t dropped_pkgs;
+
+static ssize_t kxo_dropped_show(struct device *dev,
+                                struct device_attribute *attr,
+                                char *buf)
+{
+    return snprintf(buf, PAGE_SIZE, "%ld\n", atomic_long_read(&dropped_pkgs));
+}
+
+static DEVICE_ATTR_RO(kxo_dropped);
+
+/* Games, moves and results of all games, counted per CPU so that the commit
+ * and game-end paths never share a cache line, and summed when read.
+ */
+struct kxo_counters {
+    u64 games;
+    u64 moves;
+    u64 o_wins;
+    u64 x_wins;
+    u64 draws;
+};
+
+static DEFINE_PER_CPU(struct kxo_counters, kxo_counters);
+
+static ssize_t kxo_stats_show(struct device *dev,
+                              struct device_attribute *attr,
+                              char *buf)
+{
+    struct kxo_counters sum = {0};
+    int cpu;
+
+    for_each_possible_cpu (cpu) {
+        const struct kxo_counters *c = per_cpu_ptr(&kxo_counters, cpu);
+
+        sum.games += READ_ONCE(c->games);
+        sum.moves += READ_ONCE(c->moves);
+        sum.o_wins += READ_ONCE(c->o_wins);
+        sum.x_wins += READ_ONCE(c->x_wins);
+        sum.draws += READ_ONCE(c->draws);
+    }
+    return snprintf(buf, PAGE_SIZE,
+                    "games %llu\nmoves %llu\no_wins %llu\nx_wins %llu\n"
+                    "draws %llu\n",
+                    sum.games, sum.moves, sum.o_wins, sum.x_wins, sum.draws);
+}
+
+/* Writing 0 resets the counters. Increments racing with the reset on other
+ * CPUs may survive it.
+ */
+static ssize_t kxo_stats_store(struct device *dev,
+                               struct device_attribute *attr,
+                               const char *buf,
+                               size_t count)
+{
+    int val;
+    int ret = kstrtoint(buf, 10, &val);
+    int cpu;
 
-/* Timer to simulate a periodic IRQ */
-static struct timer_list timer;
+    if (ret)
+        return ret;
+    if (val)
+        return -EINVAL;
+    for_each_possible_cpu (cpu) {
+        struct kxo_counters *c = per_cpu_ptr(&kxo_counters, cpu);
+
+        WRITE_ONCE(c->games, 0);
+        WRITE_ONCE(c->moves, 0);
+        WRITE_ONCE(c->o_wins, 0);
+        WRITE_ONCE(c->x_wins, 0);
+        WRITE_ONCE(c->draws, 0);
+    }
+    return count;
+}
+
+static DEVICE_ATTR_RW(kxo_stats);
 
 /* Character device stuff */
 static int major;
 static struct class *kxo_class;
 static struct cdev kxo_cdev;
 
-/* Data are stored into a kfifo buffer before passing them to the userspace */
-static DECLARE_KFIFO_PTR(rx_fifo, unsigned char);
+/* Workqueue for asynchronous bottom-half processing */
+static struct workqueue_struct *kxo_workqueue;
 
-/* NOTE: the usage of kfifo is safe (no need for extra locking), until there is
- * only one concurrent reader and one concurrent writer. Writes are serialized
- * from the interrupt context, readers are serialized using this mutex.
+/* The negamax players of all games share the global search state of negamax
+ * and take turns on it. MCTS searches with a state per game instead.
  */
-static DEFINE_MUTEX(read_lock);
+static DEFINE_MUTEX(engine_lock);
 
-/* Wait queue to implement blocking I/O from userspace */
-static DECLARE_WAIT_QUEUE_HEAD(rx_wait);
+/* Every open() of the device starts a game of its own, played until the file
+ * is released. Its moves are read back from that file only.
+ */
+struct kxo_game {
+    int id;
+    pid_t pid; /* thread group which opened the file */
+    char table[N_GRIDS];
+    char turn;
+    int finish;
+    bool closing;
+    struct package pkg;
+
+    /* Random state of the playouts of the game's MCTS player */
+    struct mcts_info mcts_info;
+
+    /* Side played by moves written into the file, ' ' if none, and whether
+     * the game waits for such a move. The tasklet hands the turn over to the
+     * external side under external_lock, which changes of that side also
+     * take, so that a turn is never awaited from a side no longer external.
+     */
+    char external;
+    bool awaiting;
+    spinlock_t external_lock;
+    u64 awaiting_since;
 
+    /* Time spent choosing moves, by the engines or the external side, last
+     * and in total over thinks moves. Written under producer_lock.
+     */
+    s64 think_last_ns;
+    s64 think_total_ns;
+    u64 thinks;
 
+    /* Page mapped read-only by mmap() of the file, rewritten by the writers
+     * of the game under producer_lock
+     */
+    struct kxo_snapshot *snapshot;
 
-/* Mutex to serialize kfifo writers within the workqueue handler */
-static DEFINE_MUTEX(producer_lock);
+    /* Data are stored into a kfifo buffer before passing them to the
+     * userspace.
+     */
+    DECLARE_KFIFO_PTR(rx_fifo, unsigned char);
 
-/* We use an additional "faster" circular buffer to quickly store data from
- * interrupt context, before adding them to the kfifo.
- */
-static struct circ_buf fast_buf;
+    /* NOTE: the usage of kfifo is safe (no need for extra locking), until
+     * there is only one concurrent reader and one concurrent writer. Writes
+     * are serialized from the interrupt context, readers are serialized using
+     * this mutex.
+     */
+    struct mutex read_lock;
 
-static char table[N_GRIDS];
+    /* Wait queue to implement blocking I/O from userspace */
+    wait_queue_head_t rx_wait;
 
-/* Insert the whole chess board into the kfifo buffer */
-static void produce_board(void)
-{
-    unsigned int len =
-        kfifo_in(&rx_fifo, (const unsigned char *) &pkg_obj, sizeof(pkg_obj));
-    if (unlikely(len < sizeof(pkg_obj)) && printk_ratelimit())
-        pr_warn("%s: %zu bytes dropped\n", __func__, sizeof(pkg_obj) - len);
+    /* Serializes the writers of the game: the kfifo producers, the moves and
+     * the end of a game. The timer takes it in softirq context, so process
+     * context takes it with bottom halves disabled, and nothing sleeps under
+     * it.
+     */
+    spinlock_t producer_lock;
 
-    pr_debug("kxo: %s: in %u/%u bytes\n", __func__, len, kfifo_len(&rx_fifo));
-}
+    /* Timer to simulate a periodic IRQ */
+    struct timer_list timer;
 
-/* Clear all data from the circular buffer fast_buf */
-static void fast_buf_clear(void)
+    /* Tasklet for asynchronous bottom-half processing in softirq context */
+    struct tasklet_struct tasklet;
+
+    /* Work items: hold a pointer to the function that is going to be
+     * executed asynchronously.
+     */
+    struct work_struct drawboard_work;
+    struct work_struct ai_one_work;
+    struct work_struct ai_two_work;
+
+    /* Asynchronous analysis jobs submitted on the file. Completed ones wait
+     * on jobs_done to be reaped, jobs_eventfd being signalled for each.
+     * jobs_queued counts the jobs submitted and not reaped yet, jobs_running
+     * those not completed yet.
+     */
+    spinlock_t jobs_lock;
+    struct list_head jobs_done;
+    struct eventfd_ctx *jobs_eventfd;
+    atomic_t jobs_queued;
+    atomic_t jobs_running;
+    wait_queue_head_t jobs_wait;
+
+    /* Entry in kxo_games, freed after a grace period for its RCU readers */
+    struct hlist_node node;
+    struct rcu_head rcu;
+};
+
+/* Games of all open files, listed by /proc/kxo_games under RCU. Writers only
+ * take kxo_games_lock, on open() and release().
+ */
+static HLIST_HEAD(kxo_games);
+static DEFINE_SPINLOCK(kxo_games_lock);
+
+static atomic_t game_ids;
+
+/* Insert the whole chess board into the kfifo buffer. Packages are queued
+ * whole or not at all, so readers never see a partial one.
+ */
+static void produce_board(struct kxo_game *game)
 {
-    fast_buf.head = fast_buf.tail = 0;
+    unsigned int len = 0;
+
+    game->pkg.ts = ktime_get_ns();
+    if (kfifo_avail(&game->rx_fifo) >= sizeof(game->pkg))
+        len = kfifo_in(&game->rx_fifo, (const unsigned char *) &game->pkg,
+                       sizeof(game->pkg));
+    if (unlikely(len < sizeof(game->pkg))) {
+        atomic_long_inc(&dropped_pkgs);
+        if (printk_ratelimit())
+            pr_warn("%s: game %d: %zu bytes dropped\n", __func__, game->id,
+                    sizeof(game->pkg));
+    }
+
+    pr_debug("kxo: %s: in %u/%u bytes\n", __func__, len,
+             kfifo_len(&game->rx_fifo));
 }
 
 /* Workqueue handler: executed by a kernel thread */
 static void drawboard_work_func(struct work_struct *w)
 {
+    struct kxo_game *game = container_of(w, struct kxo_game, drawboard_work);
     int cpu;
 
     /* This code runs from a kernel thread, so softirqs and hard-irqs must
@@ -139,7 +358,7 @@ static void drawboard_work_func(struct work_struct *w)
      * during the pr_info().
      */
     cpu = get_cpu();
-    pr_info("kxo: [CPU#%d] %s\n", cpu, __func__);
+    pr_info("kxo: [CPU#%d] %s game %d\n", cpu, __func__, game->id);
     put_cpu();
 
     read_lock(&attr_obj.lock);
@@ -150,19 +369,79 @@ static void drawboard_work_func(struct work_struct *w)
     read_unlock(&attr_obj.lock);
 
     /* Store data to the kfifo buffer */
-    mutex_lock(&producer_lock);
-    produce_board();
-    WRITE_ONCE(pkg_obj.move, -1);
-    mutex_unlock(&producer_lock);
+    spin_lock_bh(&game->producer_lock);
+    produce_board(game);
+    WRITE_ONCE(game->pkg.move, -1);
+    spin_unlock_bh(&game->producer_lock);
+
+    wake_up_interruptible(&game->rx_wait);
+}
+
+/* Publish the board of @game to its snapshot page, @move having just been
+ * played, or the game having ended with @result. Called with producer_lock
+ * held, the writers being serialized by it. Readers in userspace retry while
+ * seq is odd or has changed under them.
+ */
+static void snapshot_update(struct kxo_game *game, int move, char result)
+{
+    struct kxo_snapshot *snap = game->snapshot;
+
+    WRITE_ONCE(snap->seq, snap->seq + 1);
+    smp_wmb();
+
+    if (result != ' ') {
+        snap->games++;
+    } else if (snap->result != ' ') {
+        /* First move of the next game */
+        snap->moves = 0;
+        snap->last_move = -1;
+    }
+    if (move != -1) {
+        snap->moves++;
+        snap->last_move = move;
+    }
+    memcpy(snap->table, game->table, N_GRIDS);
+    snap->turn = game->turn;
+    snap->result = result;
+    snap->ts = ktime_get_ns();
+
+    smp_wmb();
+    WRITE_ONCE(snap->seq, snap->seq + 1);
+}
 
-    wake_up_interruptible(&rx_wait);
+/* Account @ns spent choosing the next move of @game. Called with
+ * producer_lock held.
+ */
+static void game_think(struct kxo_game *game, s64 ns)
+{
+    WRITE_ONCE(game->think_last_ns, ns);
+    WRITE_ONCE(game->think_total_ns, game->think_total_ns + ns);
+    WRITE_ONCE(game->thinks, game->thinks + 1);
 }
 
-static char turn;
-static int finish;
+/* Commit @move of @player and hand the turn over, for the AI work items and
+ * the moves written into the device alike. Called with producer_lock held.
+ */
+static void game_play(struct kxo_game *game, char player, int move)
+{
+    smp_mb();
+
+    if (move != -1)
+        WRITE_ONCE(game->table[move], player);
+
+    WRITE_ONCE(game->turn, player == 'O' ? 'X' : 'O');
+    WRITE_ONCE(game->finish, 1);
+    WRITE_ONCE(game->pkg.val, PKG_PUT_AI(game->pkg, player));
+    WRITE_ONCE(game->pkg.move, move);
+    smp_wmb();
+    snapshot_update(game, move, ' ');
+    if (move != -1)
+        this_cpu_inc(kxo_counters.moves);
+}
 
 static void ai_one_work_func(struct work_struct *w)
 {
+    struct kxo_game *game = container_of(w, struct kxo_game, ai_one_work);
     ktime_t tv_start, tv_end;
     s64 nsecs;
 
@@ -173,25 +452,27 @@ static void ai_one_work_func(struct work_struct *w)
 
     cpu = get_cpu();
     pr_info("kxo: [CPU#%d] start doing %s\n", cpu, __func__);
-    tv_start = ktime_get();
-    mutex_lock(&producer_lock);
-    int move;
-    WRITE_ONCE(move, mcts(table, 'O'));
-
-    smp_mb();
+    put_cpu();
 
-    if (move != -1)
-        WRITE_ONCE(table[move], 'O');
+    /* The search draws its playouts from the game's own state, so that the
+     * MCTS players of all games search in parallel
+     */
+    struct mcts_config config = {
+        .iterations = ITERATIONS,
+        .rollouts = READ_ONCE(mcts_config.rollouts),
+        .rave = READ_ONCE(mcts_config.rave),
+    };
+    tv_start = ktime_get();
+    int move = mcts_search_r(game->table, 'O', &config, &game->mcts_info, NULL);
 
-    WRITE_ONCE(turn, 'X');
-    WRITE_ONCE(finish, 1);
-    WRITE_ONCE(pkg_obj.val, PKG_PUT_AI(pkg_obj, 'O'));
-    WRITE_ONCE(pkg_obj.move, move);
-    smp_wmb();
-    mutex_unlock(&producer_lock);
+    spin_lock_bh(&game->producer_lock);
+    game_think(game, ktime_to_ns(ktime_sub(ktime_get(), tv_start)));
+    game_play(game, 'O', move);
+    spin_unlock_bh(&game->producer_lock);
     tv_end = ktime_get();
 
     nsecs = (s64) ktime_to_ns(ktime_sub(tv_end, tv_start));
+    cpu = get_cpu();
     pr_info("kxo: [CPU#%d] doing %s for %llu usec\n", cpu, __func__,
             (unsigned long long) nsecs >> 10);
     put_cpu();
@@ -199,6 +480,7 @@ static void ai_one_work_func(struct work_struct *w)
 
 static void ai_two_work_func(struct work_struct *w)
 {
+    struct kxo_game *game = container_of(w, struct kxo_game, ai_two_work);
     ktime_t tv_start, tv_end;
     s64 nsecs;
 
@@ -209,40 +491,26 @@ static void ai_two_work_func(struct work_struct *w)
 
     cpu = get_cpu();
     pr_info("kxo: [CPU#%d] start doing %s\n", cpu, __func__);
-    tv_start = ktime_get();
-    mutex_lock(&producer_lock);
-    int move;
-    WRITE_ONCE(move, negamax_predict(table, 'X').move);
-
-    smp_mb();
-
-    if (move != -1)
-        WRITE_ONCE(table[move], 'X');
+    put_cpu();
 
-    WRITE_ONCE(turn, 'O');
-    WRITE_ONCE(finish, 1);
-    WRITE_ONCE(pkg_obj.val, PKG_PUT_AI(pkg_obj, 'X'));
-    WRITE_ONCE(pkg_obj.move, move);
-    smp_wmb();
-    mutex_unlock(&producer_lock);
+    tv_start = ktime_get();
+    mutex_lock(&engine_lock);
+    int move = negamax_predict(game->table, 'X').move;
+    mutex_unlock(&engine_lock);
+
+    spin_lock_bh(&game->producer_lock);
+    game_think(game, ktime_to_ns(ktime_sub(ktime_get(), tv_start)));
+    game_play(game, 'X', move);
+    spin_unlock_bh(&game->producer_lock);
     tv_end = ktime_get();
 
     nsecs = (s64) ktime_to_ns(ktime_sub(tv_end, tv_start));
+    cpu = get_cpu();
     pr_info("kxo: [CPU#%d] end doing %s for %llu usec\n", cpu, __func__,
             (unsigned long long) nsecs >> 10);
     put_cpu();
 }
 
-/* Workqueue for asynchronous bottom-half processing */
-static struct workqueue_struct *kxo_workqueue;
-
-/* Work item: holds a pointer to the function that is going to be executed
- * asynchronously.
- */
-static DECLARE_WORK(drawboard_work, drawboard_work_func);
-static DECLARE_WORK(ai_one_work, ai_one_work_func);
-static DECLARE_WORK(ai_two_work, ai_two_work_func);
-
 /* Tasklet handler.
  *
  * NOTE: different tasklets can run concurrently on different processors, but
@@ -251,6 +519,7 @@ static DECLARE_WORK(ai_two_work, ai_two_work_func);
  */
 static void game_tasklet_func(unsigned long __data)
 {
+    struct kxo_game *game = (struct kxo_game *) __data;
     ktime_t tv_start, tv_end;
     s64 nsecs;
 
@@ -259,20 +528,29 @@ static void game_tasklet_func(unsigned long __data)
 
     tv_start = ktime_get();
 
-    READ_ONCE(finish);
-    READ_ONCE(turn);
+    READ_ONCE(game->finish);
+    READ_ONCE(game->turn);
     smp_rmb();
 
-    if (finish && turn == 'O') {
-        WRITE_ONCE(finish, 0);
+    spin_lock(&game->external_lock);
+    if (game->finish && game->turn == game->external) {
+        /* The move is to be written into the device */
+        WRITE_ONCE(game->finish, 0);
+        game->awaiting_since = ktime_get_ns();
+        WRITE_ONCE(game->awaiting, true);
+        smp_wmb();
+        wake_up_interruptible(&game->rx_wait);
+    } else if (game->finish && game->turn == 'O') {
+        WRITE_ONCE(game->finish, 0);
         smp_wmb();
-        queue_work(kxo_workqueue, &ai_one_work);
-    } else if (finish && turn == 'X') {
-        WRITE_ONCE(finish, 0);
+        queue_work(kxo_workqueue, &game->ai_one_work);
+    } else if (game->finish && game->turn == 'X') {
+        WRITE_ONCE(game->finish, 0);
         smp_wmb();
-        queue_work(kxo_workqueue, &ai_two_work);
+        queue_work(kxo_workqueue, &game->ai_two_work);
     }
-    queue_work(kxo_workqueue, &drawboard_work);
+    spin_unlock(&game->external_lock);
+    queue_work(kxo_workqueue, &game->drawboard_work);
     tv_end = ktime_get();
 
     nsecs = (s64) ktime_to_ns(ktime_sub(tv_end, tv_start));
@@ -281,20 +559,25 @@ static void game_tasklet_func(unsigned long __data)
             __func__, (unsigned long long) nsecs >> 10);
 }
 
-/* Tasklet for asynchronous bottom-half processing in softirq context */
-static DECLARE_TASKLET_OLD(game_tasklet, game_tasklet_func);
-
-static void ai_game(void)
+static void ai_game(struct kxo_game *game)
 {
     WARN_ON_ONCE(!irqs_disabled());
 
-    pr_info("kxo: [CPU#%d] doing AI game\n", smp_processor_id());
+    pr_info("kxo: [CPU#%d] doing AI game %d\n", smp_processor_id(), game->id);
     pr_info("kxo: [CPU#%d] scheduling tasklet\n", smp_processor_id());
-    tasklet_schedule(&game_tasklet);
+    tasklet_schedule(&game->tasklet);
 }
 
-static void timer_handler(struct timer_list *__timer)
+/* Re-arm the timer of @game, unless its file is being released */
+static void game_schedule(struct kxo_game *game)
 {
+    if (!READ_ONCE(game->closing))
+        mod_timer(&game->timer, jiffies + msecs_to_jiffies(delay));
+}
+
+static void timer_handler(struct timer_list *t)
+{
+    struct kxo_game *game = from_timer(game, t, timer);
     ktime_t tv_start, tv_end;
     s64 nsecs;
 
@@ -309,35 +592,46 @@ static void timer_handler(struct timer_list *__timer)
 
     tv_start = ktime_get();
 
-    char win = check_win(table);
+    char win = check_win(game->table);
 
     if (win == ' ') {
-        ai_game();
-        mod_timer(&timer, jiffies + msecs_to_jiffies(delay));
+        ai_game(game);
+        game_schedule(game);
     } else {
         read_lock(&attr_obj.lock);
         int cpu = get_cpu();
         pr_info("kxo: [CPU#%d] Drawing final board\n", cpu);
         put_cpu();
         /* Store data to the kfifo buffer */
-        mutex_lock(&producer_lock);
-        WRITE_ONCE(pkg_obj.val, PKG_SET_END(pkg_obj));
-        produce_board();
-        WRITE_ONCE(pkg_obj.val, PKG_CLR_END(pkg_obj));
-        WRITE_ONCE(pkg_obj.move, -1);
-        mutex_unlock(&producer_lock);
-
-        wake_up_interruptible(&rx_wait);
+        spin_lock(&game->producer_lock);
+        WRITE_ONCE(game->pkg.val, PKG_SET_END(game->pkg));
+        WRITE_ONCE(game->pkg.result, win);
+        produce_board(game);
+        snapshot_update(game, -1, win);
+        this_cpu_inc(kxo_counters.games);
+        if (win == 'O')
+            this_cpu_inc(kxo_counters.o_wins);
+        else if (win == 'X')
+            this_cpu_inc(kxo_counters.x_wins);
+        else
+            this_cpu_inc(kxo_counters.draws);
+        WRITE_ONCE(game->pkg.val, PKG_CLR_END(game->pkg));
+        WRITE_ONCE(game->pkg.result, ' ');
+        WRITE_ONCE(game->pkg.move, -1);
+        WRITE_ONCE(game->pkg.game, game->pkg.game + 1);
+        spin_unlock(&game->producer_lock);
+
+        wake_up_interruptible(&game->rx_wait);
 
         if (attr_obj.end == '0') {
-            memset(table, ' ',
+            memset(game->table, ' ',
                    N_GRIDS); /* Reset the table so the game restart */
-            mod_timer(&timer, jiffies + msecs_to_jiffies(delay));
+            game_schedule(game);
         }
 
         read_unlock(&attr_obj.lock);
 
-        pr_info("kxo: %c win!!!\n", win);
+        pr_info("kxo: game %d: %c win!!!\n", game->id, win);
     }
     tv_end = ktime_get();
 
@@ -354,6 +648,7 @@ static ssize_t kxo_read(struct file *file,
                         size_t count,
                         loff_t *ppos)
 {
+    struct kxo_game *game = file->private_data;
     unsigned int read;
     int ret;
 
@@ -362,11 +657,16 @@ static ssize_t kxo_read(struct file *file,
     if (unlikely(!access_ok(buf, count)))
         return -EFAULT;
 
-    if (mutex_lock_interruptible(&read_lock))
+    /* Only hand out whole packages */
+    count -= count % sizeof(struct package);
+    if (!count)
+        return -EINVAL;
+
+    if (mutex_lock_interruptible(&game->read_lock))
         return -ERESTARTSYS;
 
     do {
-        ret = kfifo_to_user(&rx_fifo, buf, count, &read);
+        ret = kfifo_to_user(&game->rx_fifo, buf, count, &read);
         if (unlikely(ret < 0))
             break;
         if (read)
@@ -375,43 +675,799 @@ static ssize_t kxo_read(struct file *file,
             ret = -EAGAIN;
             break;
         }
-        ret = wait_event_interruptible(rx_wait, kfifo_len(&rx_fifo));
+        ret = wait_event_interruptible(game->rx_wait,
+                                       kfifo_len(&game->rx_fifo));
     } while (ret == 0);
-    pr_debug("kxo: %s: out %u/%u bytes\n", __func__, read, kfifo_len(&rx_fifo));
+    pr_debug("kxo: %s: out %u/%u bytes\n", __func__, read,
+             kfifo_len(&game->rx_fifo));
 
-    mutex_unlock(&read_lock);
+    mutex_unlock(&game->read_lock);
 
     return ret ? ret : read;
 }
 
+static __poll_t kxo_poll(struct file *file, poll_table *wait)
+{
+    struct kxo_game *game = file->private_data;
+    __poll_t mask = 0;
+
+    poll_wait(file, &game->rx_wait, wait);
+    if (!kfifo_is_empty(&game->rx_fifo))
+        mask |= EPOLLIN | EPOLLRDNORM;
+    if (READ_ONCE(game->awaiting))
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    return mask;
+}
+
+/* Play the move of the external side of the game, an int square index */
+static ssize_t kxo_write(struct file *file,
+                         const char __user *buf,
+                         size_t count,
+                         loff_t *ppos)
+{
+    struct kxo_game *game = file->private_data;
+    int move;
+    ssize_t ret;
+
+    if (count != sizeof(move))
+        return -EINVAL;
+    if (copy_from_user(&move, buf, sizeof(move)))
+        return -EFAULT;
+    if (READ_ONCE(game->external) == ' ')
+        return -EPERM;
+
+    for (;;) {
+        if (!READ_ONCE(game->awaiting)) {
+            if (file->f_flags & O_NONBLOCK)
+                return -EAGAIN;
+            ret = wait_event_interruptible(game->rx_wait,
+                                           READ_ONCE(game->awaiting));
+            if (ret)
+                return ret;
+        }
+
+        spin_lock_bh(&game->producer_lock);
+        if (game->awaiting)
+            break;
+        spin_unlock_bh(&game->producer_lock);
+    }
+
+    if (move < 0 || move >= N_GRIDS || game->table[move] != ' ') {
+        ret = -EINVAL;
+    } else {
+        WRITE_ONCE(game->awaiting, false);
+        game_think(game, ktime_get_ns() - game->awaiting_since);
+        game_play(game, game->turn, move);
+        ret = count;
+    }
+    spin_unlock_bh(&game->producer_lock);
+    return ret;
+}
+
+static long kxo_set_external(struct kxo_game *game,
+                             struct file *file,
+                             unsigned long side)
+{
+    if (side != ' ' && side != 'O' && side != 'X')
+        return -EINVAL;
+    if (side != ' ' && !(file->f_mode & FMODE_WRITE))
+        return -EBADF;
+
+    /* producer_lock orders this against moves being written, external_lock
+     * against the tasklet handing the turn over
+     */
+    spin_lock_bh(&game->producer_lock);
+    spin_lock(&game->external_lock);
+    WRITE_ONCE(game->external, side);
+    if (game->awaiting && game->turn != side) {
+        /* Hand the pending move back to the AI */
+        WRITE_ONCE(game->awaiting, false);
+        WRITE_ONCE(game->finish, 1);
+    }
+    spin_unlock(&game->external_lock);
+    spin_unlock_bh(&game->producer_lock);
+    return 0;
+}
+
+static long kxo_get_board(struct kxo_game *game, struct kxo_board __user *arg)
+{
+    struct kxo_board board = {.size = BOARD_SIZE};
+
+    spin_lock_bh(&game->producer_lock);
+    memcpy(board.table, game->table, N_GRIDS);
+    board.turn = game->turn;
+    board.awaiting = game->awaiting;
+    spin_unlock_bh(&game->producer_lock);
+
+    return copy_to_user(arg, &board, sizeof(board)) ? -EFAULT : 0;
+}
+
+static long kxo_get_state(struct kxo_state __user *arg)
+{
+    struct kxo_state state = {0};
+
+    read_lock(&attr_obj.lock);
+    state.display = attr_obj.display == '1';
+    state.resume = attr_obj.resume == '1';
+    state.end = attr_obj.end == '1';
+    read_unlock(&attr_obj.lock);
+    state.rollouts = READ_ONCE(mcts_config.rollouts);
+    state.rave = READ_ONCE(mcts_config.rave);
+
+    return copy_to_user(arg, &state, sizeof(state)) ? -EFAULT : 0;
+}
+
+static bool kxo_cmd_valid(const struct kxo_cmd *cmd)
+{
+    switch (cmd->op) {
+    case KXO_CMD_DISPLAY:
+    case KXO_CMD_RESUME:
+    case KXO_CMD_END:
+        return cmd->arg <= 1;
+    case KXO_CMD_ROLLOUTS:
+        BUILD_BUG_ON(KXO_MAX_ROLLOUTS > MCTS_MAX_ROLLOUTS);
+        return cmd->arg >= 1 && cmd->arg <= KXO_MAX_ROLLOUTS;
+    case KXO_CMD_RAVE:
+        return cmd->arg <= KXO_MAX_RAVE;
+    }
+    return false;
+}
+
+/* Apply a batch of commands at once, or none of them if one is invalid */
+static long kxo_apply(struct file *file, struct kxo_cmd_batch __user *arg)
+{
+    struct kxo_cmd_batch batch;
+    struct kxo_cmd *cmds;
+    long ret = 0;
+
+    /* As the sysfs attributes it stands for, writable by their owner only */
+    if (!(file->f_mode & FMODE_WRITE))
+        return -EPERM;
+
+    if (copy_from_user(&batch, arg, sizeof(batch)))
+        return -EFAULT;
+    if (!batch.n || batch.n > KXO_MAX_CMDS)
+        return -EINVAL;
+    cmds = memdup_user(u64_to_user_ptr(batch.cmds), batch.n * sizeof(*cmds));
+    if (IS_ERR(cmds))
+        return PTR_ERR(cmds);
+
+    for (u32 i = 0; i < batch.n; i++) {
+        if (!kxo_cmd_valid(&cmds[i])) {
+            ret = -EINVAL;
+            goto out;
+        }
+    }
+
+    write_lock(&attr_obj.lock);
+    for (u32 i = 0; i < batch.n; i++) {
+        char flag = '0' + cmds[i].arg;
+
+        switch (cmds[i].op) {
+        case KXO_CMD_DISPLAY:
+            attr_obj.display = flag;
+            break;
+        case KXO_CMD_RESUME:
+            attr_obj.resume = flag;
+            break;
+        case KXO_CMD_END:
+            attr_obj.end = flag;
+            break;
+        case KXO_CMD_ROLLOUTS:
+            WRITE_ONCE(mcts_config.rollouts, cmds[i].arg);
+            break;
+        case KXO_CMD_RAVE:
+            WRITE_ONCE(mcts_config.rave, cmds[i].arg);
+            break;
+        }
+    }
+    write_unlock(&attr_obj.lock);
+out:
+    kfree(cmds);
+    return ret;
+}
+
+/* An MCTS iteration expands at most one node into up to N_GRIDS children.
+ * Bound the trees grown for userspace by what 4 * ITERATIONS iterations grow
+ * on 3x3, which keeps a search within tens of MiB on any board.
+ */
+#define ANALYSIS_MAX_ITERATIONS \
+    min(KXO_MAX_ITERATIONS, 4 * ITERATIONS * 9 / N_GRIDS)
+
+/* Negamax searches serialize on analysis_lock: bound their depth by what a
+ * position of an empty board searches within about a second.
+ */
+#if N_GRIDS <= 16
+#define ANALYSIS_MAX_DEPTH KXO_MAX_DEPTH
+#elif N_GRIDS <= 25
+#define ANALYSIS_MAX_DEPTH 8
+#else
+#define ANALYSIS_MAX_DEPTH 6
+#endif
+
+/* Negamax state of the analyses and jobs, which take turns on it but not on
+ * engine_lock with the games
+ */
+static struct negamax_state analysis_state;
+static DEFINE_MUTEX(analysis_lock);
+
+struct kxo_analysis_batch;
+
+/* Positions of an analysis batch are split in chunks, one work item each */
+struct kxo_analysis_work {
+    struct work_struct work;
+    struct kxo_position *pos;
+    unsigned int n;
+    /* Playouts of the MCTS searches of the chunk, so that chunks may run
+     * concurrently with each other and with the games
+     */
+    struct mcts_info info;
+    struct kxo_analysis_batch *batch;
+};
+
+/* A batch shared by the caller and its work items. The last of them to let
+ * go of it frees it, which is a work item if the caller was killed.
+ */
+struct kxo_analysis_batch {
+    refcount_t refs;
+    atomic_t pending;
+    struct completion done;
+    /* Set when the caller is killed, the work items skipping the positions
+     * left
+     */
+    bool cancel;
+    struct kxo_position *pos;
+    /* Memory cgroup of the caller, charged with the search trees */
+    struct mem_cgroup *memcg;
+    struct kxo_analysis_work works[];
+};
+
+static bool kxo_position_valid(const struct kxo_position *pos)
+{
+    if (pos->player != 'O' && pos->player != 'X')
+        return false;
+    for (int i = 0; i < N_GRIDS; i++) {
+        if (pos->table[i] != ' ' && pos->table[i] != 'O' &&
+            pos->table[i] != 'X')
+            return false;
+    }
+    switch (pos->engine) {
+    case KXO_ENGINE_MCTS:
+        return pos->budget <= ANALYSIS_MAX_ITERATIONS;
+    case KXO_ENGINE_NEGAMAX:
+        /* Deepened two plies at a time from 2 */
+        if (!pos->budget)
+            return true;
+        return pos->budget >= 2 && pos->budget <= ANALYSIS_MAX_DEPTH &&
+               !(pos->budget & 1);
+    }
+    return false;
+}
+
+static void analyze_position(struct kxo_position *pos, struct mcts_info *info)
+{
+    char table[N_GRIDS];
+
+    memcpy(table, pos->table, N_GRIDS);
+    pos->move = -1;
+    pos->score = 0;
+    if (check_win(table) != ' ')
+        return;
+
+    if (pos->engine == KXO_ENGINE_MCTS) {
+        struct mcts_config config = {
+            .iterations = pos->budget ? pos->budget : ITERATIONS,
+            .rollouts = READ_ONCE(mcts_config.rollouts),
+            .rave = READ_ONCE(mcts_config.rave),
+            .account = true,
+        };
+        fixed_point_t value = 0;
+
+        pos->move = mcts_search_r(table, pos->player, &config, info, &value);
+        pos->score = (value * 1000) >> FIXED_SCALE_BITS;
+    } else {
+        int depth = pos->budget ? pos->budget : MAX_SEARCH_DEPTH;
+        move_t best;
+
+        mutex_lock(&analysis_lock);
+        best = negamax_predict_depth_r(&analysis_state, table, pos->player,
+                                       depth);
+        mutex_unlock(&analysis_lock);
+        pos->move = best.move;
+        pos->score = best.score;
+    }
+}
+
+static void analysis_batch_put(struct kxo_analysis_batch *batch)
+{
+    if (!refcount_dec_and_test(&batch->refs))
+        return;
+    mem_cgroup_put(batch->memcg);
+    kvfree(batch->pos);
+    kfree(batch);
+}
+
+static void analysis_work_func(struct work_struct *w)
+{
+    struct kxo_analysis_work *aw =
+        container_of(w, struct kxo_analysis_work, work);
+    struct kxo_analysis_batch *batch = aw->batch;
+    struct mem_cgroup *old = set_active_memcg(batch->memcg);
+
+    for (unsigned int i = 0; i < aw->n && !READ_ONCE(batch->cancel); i++) {
+        analyze_position(&aw->pos[i], &aw->info);
+        cond_resched();
+    }
+    set_active_memcg(old);
+    if (atomic_dec_and_test(&batch->pending))
+        complete(&batch->done);
+    /* May free @aw along with the batch */
+    analysis_batch_put(batch);
+}
+
+/* Analyze a batch of positions, spread over twice as many work items as
+ * there are CPUs online, and wait for all of them
+ */
+static long kxo_analyze(struct file *file, struct kxo_analysis __user *arg)
+{
+    struct kxo_analysis req;
+    struct kxo_analysis_batch *batch;
+    struct kxo_position *pos;
+    unsigned int n_works, start = 0;
+    long ret = 0;
+
+    /* Searches cost CPU time and memory, spent by writers only */
+    if (!(file->f_mode & FMODE_WRITE))
+        return -EPERM;
+
+    if (copy_from_user(&req, arg, sizeof(req)))
+        return -EFAULT;
+    if (!req.n || req.n > KXO_MAX_POSITIONS)
+        return -EINVAL;
+    pos = vmemdup_user(u64_to_user_ptr(req.positions), req.n * sizeof(*pos));
+    if (IS_ERR(pos))
+        return PTR_ERR(pos);
+    for (u32 i = 0; i < req.n; i++) {
+        if (!kxo_position_valid(&pos[i])) {
+            kvfree(pos);
+            return -EINVAL;
+        }
+    }
+
+    n_works = min(req.n, 2 * num_online_cpus());
+    batch = kzalloc(struct_size(batch, works, n_works), GFP_KERNEL_ACCOUNT);
+    if (!batch) {
+        kvfree(pos);
+        return -ENOMEM;
+    }
+    refcount_set(&batch->refs, n_works + 1);
+    atomic_set(&batch->pending, n_works);
+    init_completion(&batch->done);
+    batch->pos = pos;
+    batch->memcg = get_mem_cgroup_from_mm(current->mm);
+    for (unsigned int i = 0; i < n_works; i++) {
+        struct kxo_analysis_work *aw = &batch->works[i];
+        unsigned int end = (u64) req.n * (i + 1) / n_works;
+
+        INIT_WORK(&aw->work, analysis_work_func);
+        aw->pos = pos + start;
+        aw->n = end - start;
+        aw->info.xoro_obj.array[0] = get_random_u64();
+        aw->info.xoro_obj.array[1] = get_random_u64() | 1;
+        aw->batch = batch;
+        queue_work(kxo_workqueue, &aw->work);
+        start = end;
+    }
+
+    if (wait_for_completion_killable(&batch->done)) {
+        /* The work items finish the positions they are on, then free the
+         * batch
+         */
+        WRITE_ONCE(batch->cancel, true);
+        ret = -EINTR;
+    } else if (copy_to_user(u64_to_user_ptr(req.positions), pos,
+                            req.n * sizeof(*pos))) {
+        ret = -EFAULT;
+    }
+    analysis_batch_put(batch);
+    return ret;
+}
+
+/* One asynchronous analysis job, queued as a work item of its own */
+struct kxo_job_work {
+    struct work_struct work;
+    struct list_head list;
+    struct kxo_game *game;
+    /* Memory cgroup of the submitter, charged with the search tree */
+    struct mem_cgroup *memcg;
+    struct kxo_job job;
+};
+
+static void job_work_func(struct work_struct *w)
+{
+    struct kxo_job_work *jw = container_of(w, struct kxo_job_work, work);
+    struct kxo_game *game = jw->game;
+    struct mcts_info info = {
+        .xoro_obj.array = {get_random_u64(), get_random_u64() | 1},
+    };
+    struct mem_cgroup *old = set_active_memcg(jw->memcg);
+
+    /* Jobs not started when their file is released are dropped unsearched */
+    if (!READ_ONCE(game->closing))
+        analyze_position(&jw->job.pos, &info);
+    set_active_memcg(old);
+    mem_cgroup_put(jw->memcg);
+
+    /* Once the lock is released, the file may be released and @game freed */
+    spin_lock(&game->jobs_lock);
+    list_add_tail(&jw->list, &game->jobs_done);
+    if (game->jobs_eventfd) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 8, 0)
+        eventfd_signal(game->jobs_eventfd, 1);
+#else
+        eventfd_signal(game->jobs_eventfd);
+#endif
+    }
+    if (atomic_dec_and_test(&game->jobs_running))
+        wake_up(&game->jobs_wait);
+    spin_unlock(&game->jobs_lock);
+}
+
+static long kxo_submit(struct file *file, struct kxo_jobs __user *arg)
+{
+    struct kxo_game *game = file->private_data;
+    struct kxo_jobs req;
+    struct kxo_job *jobs;
+    int queued;
+    u32 n, i;
+    long ret;
+
+    /* As KXO_IOC_ANALYZE */
+    if (!(file->f_mode & FMODE_WRITE))
+        return -EPERM;
+
+    if (copy_from_user(&req, arg, sizeof(req)))
+        return -EFAULT;
+    if (!req.n || req.n > KXO_MAX_JOBS)
+        return -EINVAL;
+    jobs = vmemdup_user(u64_to_user_ptr(req.jobs), req.n * sizeof(*jobs));
+    if (IS_ERR(jobs))
+        return PTR_ERR(jobs);
+    for (i = 0; i < req.n; i++) {
+        if (!kxo_position_valid(&jobs[i].pos)) {
+            ret = -EINVAL;
+            goto out;
+        }
+    }
+
+    /* Take as many jobs as there is room for */
+    n = req.n;
+    queued = atomic_add_return(n, &game->jobs_queued);
+    if (queued > KXO_MAX_JOBS) {
+        u32 excess = min_t(u32, queued - KXO_MAX_JOBS, n);
+
+        atomic_sub(excess, &game->jobs_queued);
+        n -= excess;
+    }
+    if (!n) {
+        ret = -EAGAIN;
+        goto out;
+    }
+
+    for (i = 0; i < n; i++) {
+        struct kxo_job_work *jw = kmalloc(sizeof(*jw), GFP_KERNEL_ACCOUNT);
+
+        if (!jw) {
+            atomic_sub(n - i, &game->jobs_queued);
+            break;
+        }
+        INIT_WORK(&jw->work, job_work_func);
+        jw->game = game;
+        jw->memcg = get_mem_cgroup_from_mm(current->mm);
+        jw->job = jobs[i];
+        atomic_inc(&game->jobs_running);
+        queue_work(kxo_workqueue, &jw->work);
+    }
+    ret = i ? i : -ENOMEM;
+out:
+    kvfree(jobs);
+    return ret;
+}
+
+static long kxo_reap(struct kxo_game *game, struct kxo_jobs __user *arg)
+{
+    struct kxo_jobs req;
+    struct kxo_job __user *out;
+    struct kxo_job_work *jw, *tmp;
+    LIST_HEAD(done);
+    bool fault = false;
+    u32 n = 0;
+
+    if (copy_from_user(&req, arg, sizeof(req)))
+        return -EFAULT;
+    if (!req.n || req.n > KXO_MAX_JOBS)
+        return -EINVAL;
+    out = u64_to_user_ptr(req.jobs);
+
+    spin_lock(&game->jobs_lock);
+    list_for_each_entry_safe(jw, tmp, &game->jobs_done, list) {
+        if (n++ == req.n)
+            break;
+        list_move_tail(&jw->list, &done);
+    }
+    spin_unlock(&game->jobs_lock);
+
+    n = 0;
+    list_for_each_entry_safe(jw, tmp, &done, list) {
+        if (copy_to_user(&out[n], &jw->job, sizeof(jw->job))) {
+            fault = true;
+            break;
+        }
+        list_del(&jw->list);
+        kfree(jw);
+        n++;
+    }
+    if (fault) {
+        /* Keep the jobs which could not be copied out for the next reap */
+        spin_lock(&game->jobs_lock);
+        list_splice(&done, &game->jobs_done);
+        spin_unlock(&game->jobs_lock);
+    }
+    atomic_sub(n, &game->jobs_queued);
+    return fault && !n ? -EFAULT : n;
+}
+
+static long kxo_set_eventfd(struct kxo_game *game, int fd)
+{
+    struct eventfd_ctx *ctx = NULL, *old;
+
+    if (fd >= 0) {
+        ctx = eventfd_ctx_fdget(fd);
+        if (IS_ERR(ctx))
+            return PTR_ERR(ctx);
+    }
+    spin_lock(&game->jobs_lock);
+    old = game->jobs_eventfd;
+    game->jobs_eventfd = ctx;
+    spin_unlock(&game->jobs_lock);
+    if (old)
+        eventfd_ctx_put(old);
+    return 0;
+}
+
+/* Wait for the running jobs of @game, then drop the completed ones */
+static void kxo_jobs_release(struct kxo_game *game)
+{
+    struct kxo_job_work *jw, *tmp;
+    LIST_HEAD(done);
+
+    wait_event(game->jobs_wait, !atomic_read(&game->jobs_running));
+
+    spin_lock(&game->jobs_lock);
+    list_splice_init(&game->jobs_done, &done);
+    spin_unlock(&game->jobs_lock);
+    list_for_each_entry_safe(jw, tmp, &done, list)
+        kfree(jw);
+    if (game->jobs_eventfd)
+        eventfd_ctx_put(game->jobs_eventfd);
+}
+
+/* Map the snapshot page of the game, read-only */
+static int kxo_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct kxo_game *game = file->private_data;
+
+    if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE)
+        return -EINVAL;
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 3, 0)
+    vma->vm_flags &= ~VM_MAYWRITE;
+#else
+    vm_flags_clear(vma, VM_MAYWRITE);
+#endif
+    /* The mapping holds a reference to the file, which keeps the page */
+    return remap_pfn_range(vma, vma->vm_start,
+                           virt_to_phys(game->snapshot) >> PAGE_SHIFT,
+                           PAGE_SIZE, vma->vm_page_prot);
+}
+
+static long kxo_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    switch (cmd) {
+    case KXO_IOC_GET_STATE:
+        return kxo_get_state((struct kxo_state __user *) arg);
+    case KXO_IOC_APPLY:
+        return kxo_apply(file, (struct kxo_cmd_batch __user *) arg);
+    case KXO_IOC_SET_EXTERNAL:
+        return kxo_set_external(file->private_data, file, arg);
+    case KXO_IOC_GET_BOARD:
+        return kxo_get_board(file->private_data,
+                             (struct kxo_board __user *) arg);
+    case KXO_IOC_ANALYZE:
+        return kxo_analyze(file, (struct kxo_analysis __user *) arg);
+    case KXO_IOC_SUBMIT:
+        return kxo_submit(file, (struct kxo_jobs __user *) arg);
+    case KXO_IOC_REAP:
+        return kxo_reap(file->private_data, (struct kxo_jobs __user *) arg);
+    case KXO_IOC_SET_EVENTFD:
+        return kxo_set_eventfd(file->private_data, (int) arg);
+    default:
+        return -ENOTTY;
+    }
+}
+
 static atomic_t open_cnt;
 
+/* Free @game once the readers of kxo_games are done with it */
+static void game_free_rcu(struct rcu_head *rcu)
+{
+    struct kxo_game *game = container_of(rcu, struct kxo_game, rcu);
+
+    kfifo_free(&game->rx_fifo);
+    free_page((unsigned long) game->snapshot);
+    kfree(game);
+}
+
 static int kxo_open(struct inode *inode, struct file *filp)
 {
+    struct kxo_game *game;
+
     pr_debug("kxo: %s\n", __func__);
-    if (atomic_inc_return(&open_cnt) == 1)
-        mod_timer(&timer, jiffies + msecs_to_jiffies(delay));
-    pr_info("openm current cnt: %d\n", atomic_read(&open_cnt));
+    game = kzalloc(sizeof(*game), GFP_KERNEL);
+    if (!game)
+        return -ENOMEM;
+    if (kfifo_alloc(&game->rx_fifo, PAGE_SIZE, GFP_KERNEL) < 0) {
+        kfree(game);
+        return -ENOMEM;
+    }
+    BUILD_BUG_ON(sizeof(*game->snapshot) > PAGE_SIZE);
+    game->snapshot = (struct kxo_snapshot *) get_zeroed_page(GFP_KERNEL);
+    if (!game->snapshot) {
+        kfifo_free(&game->rx_fifo);
+        kfree(game);
+        return -ENOMEM;
+    }
+
+    game->id = atomic_inc_return(&game_ids);
+    memset(game->table, ' ', N_GRIDS);
+    game->turn = 'O';
+    game->finish = 1;
+    game->pkg.val = ' ';
+    game->pkg.result = ' ';
+    game->pkg.move = -1;
+    game->external = ' ';
+    game->mcts_info.xoro_obj.array[0] = get_random_u64();
+    game->mcts_info.xoro_obj.array[1] = get_random_u64() | 1;
+    game->snapshot->size = BOARD_SIZE;
+    game->snapshot->turn = game->turn;
+    game->snapshot->result = ' ';
+    game->snapshot->last_move = -1;
+    game->snapshot->ts = ktime_get_ns();
+    memcpy(game->snapshot->table, game->table, N_GRIDS);
+    spin_lock_init(&game->external_lock);
+    mutex_init(&game->read_lock);
+    spin_lock_init(&game->producer_lock);
+    init_waitqueue_head(&game->rx_wait);
+    tasklet_init(&game->tasklet, game_tasklet_func, (unsigned long) game);
+    INIT_WORK(&game->drawboard_work, drawboard_work_func);
+    INIT_WORK(&game->ai_one_work, ai_one_work_func);
+    INIT_WORK(&game->ai_two_work, ai_two_work_func);
+    timer_setup(&game->timer, timer_handler, 0);
+    spin_lock_init(&game->jobs_lock);
+    INIT_LIST_HEAD(&game->jobs_done);
+    init_waitqueue_head(&game->jobs_wait);
+    game->pid = task_tgid_nr(current);
+    filp->private_data = game;
+
+    spin_lock(&kxo_games_lock);
+    hlist_add_head_rcu(&game->node, &kxo_games);
+    spin_unlock(&kxo_games_lock);
+
+    atomic_inc(&open_cnt);
+    game_schedule(game);
+    pr_info("kxo: game %d started, current cnt: %d\n", game->id,
+            atomic_read(&open_cnt));
 
     return 0;
 }
 
 static int kxo_release(struct inode *inode, struct file *filp)
 {
+    struct kxo_game *game = filp->private_data;
+
     pr_debug("kxo: %s\n", __func__);
-    if (atomic_dec_and_test(&open_cnt)) {
-        del_timer_sync(&timer);
-        flush_workqueue(kxo_workqueue);
-        fast_buf_clear();
+
+    /* The timer re-arms itself and schedules the tasklet, which queues the
+     * work items: stop them in that order.
+     */
+    WRITE_ONCE(game->closing, true);
+    del_timer_sync(&game->timer);
+    tasklet_kill(&game->tasklet);
+    cancel_work_sync(&game->ai_one_work);
+    cancel_work_sync(&game->ai_two_work);
+    cancel_work_sync(&game->drawboard_work);
+    kxo_jobs_release(game);
+
+    spin_lock(&kxo_games_lock);
+    hlist_del_rcu(&game->node);
+    spin_unlock(&kxo_games_lock);
+    pr_info("kxo: game %d released\n", game->id);
+    call_rcu(&game->rcu, game_free_rcu);
+
+    if (atomic_dec_and_test(&open_cnt))
         attr_obj.end = '0';
-    }
     pr_info("release, current cnt: %d\n", atomic_read(&open_cnt));
 
     return 0;
 }
 
+/* /proc/kxo_games: one line per open game, read under RCU only, so that
+ * listing thousands of games holds up none of them
+ */
+static void *games_seq_start(struct seq_file *m, loff_t *pos) __acquires(RCU)
+{
+    rcu_read_lock();
+    return seq_hlist_start_head_rcu(&kxo_games, *pos);
+}
+
+static void *games_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+    return seq_hlist_next_rcu(v, &kxo_games, pos);
+}
+
+static void games_seq_stop(struct seq_file *m, void *v) __releases(RCU)
+{
+    rcu_read_unlock();
+}
+
+static const char *game_engine(struct kxo_game *game, char side)
+{
+    if (READ_ONCE(game->external) == side)
+        return "user";
+    return side == 'O' ? "mcts" : "negamax";
+}
+
+static int games_seq_show(struct seq_file *m, void *v)
+{
+    struct kxo_game *game;
+    u64 thinks;
+    s64 total;
+
+    if (v == SEQ_START_TOKEN) {
+        seq_printf(m, "%8s %8s %5s %4s %-7s %-7s %10s %10s %7s\n", "id",
+                   "pid", "moves", "turn", "O", "X", "think_us", "avg_us",
+                   "queued");
+        return 0;
+    }
+
+    game = hlist_entry(v, struct kxo_game, node);
+    thinks = READ_ONCE(game->thinks);
+    total = READ_ONCE(game->think_total_ns);
+    seq_printf(m, "%8d %8d %5u %4c %-7s %-7s %10lld %10llu %7u\n", game->id,
+               game->pid, READ_ONCE(game->snapshot->moves),
+               READ_ONCE(game->turn), game_engine(game, 'O'),
+               game_engine(game, 'X'),
+               div_s64(READ_ONCE(game->think_last_ns), NSEC_PER_USEC),
+               thinks ? div64_u64(total, thinks * NSEC_PER_USEC) : 0,
+               kfifo_len(&game->rx_fifo));
+    return 0;
+}
+
+static const struct seq_operations games_seq_ops = {
+    .start = games_seq_start,
+    .next = games_seq_next,
+    .stop = games_seq_stop,
+    .show = games_seq_show,
+};
+
 static const struct file_operations kxo_fops = {
     .read = kxo_read,
+    .write = kxo_write,
+    .poll = kxo_poll,
+    .mmap = kxo_mmap,
+    .unlocked_ioctl = kxo_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
     .llseek = no_llseek,
     .open = kxo_open,
     .release = kxo_release,
@@ -423,13 +1479,10 @@ static int __init kxo_init(void)
     dev_t dev_id;
     int ret;
 
-    if (kfifo_alloc(&rx_fifo, PAGE_SIZE, GFP_KERNEL) < 0)
-        return -ENOMEM;
-
     /* Register major/minor numbers */
     ret = alloc_chrdev_region(&dev_id, 0, NR_KMLDRV, DEV_NAME);
     if (ret)
-        goto error_alloc;
+        goto out;
     major = MAJOR(dev_id);
 
     /* Add the character device to the system */
@@ -462,19 +1515,41 @@ static int __init kxo_init(void)
         goto error_cdev;
     }
 
-    /* Allocate fast circular buffer */
-    fast_buf.buf = vmalloc(PAGE_SIZE);
-    if (!fast_buf.buf) {
-        device_destroy(kxo_class, dev_id);
-        class_destroy(kxo_class);
-        ret = -ENOMEM;
+    ret = device_create_file(kxo_dev, &dev_attr_kxo_rollouts);
+    if (ret < 0) {
+        printk(KERN_ERR "failed to create sysfs file kxo_rollouts\n");
+        goto error_cdev;
+    }
+
+    ret = device_create_file(kxo_dev, &dev_attr_kxo_rave);
+    if (ret < 0) {
+        printk(KERN_ERR "failed to create sysfs file kxo_rave\n");
+        goto error_cdev;
+    }
+
+    ret = device_create_file(kxo_dev, &dev_attr_kxo_dropped);
+    if (ret < 0) {
+        printk(KERN_ERR "failed to create sysfs file kxo_dropped\n");
+        goto error_cdev;
+    }
+
+    ret = device_create_file(kxo_dev, &dev_attr_kxo_stats);
+    if (ret < 0) {
+        printk(KERN_ERR "failed to create sysfs file kxo_stats\n");
         goto error_cdev;
     }
 
     /* Create the workqueue */
     kxo_workqueue = alloc_workqueue("kxod", WQ_UNBOUND, WQ_MAX_ACTIVE);
     if (!kxo_workqueue) {
-        vfree(fast_buf.buf);
+        device_destroy(kxo_class, dev_id);
+        class_destroy(kxo_class);
+        ret = -ENOMEM;
+        goto error_cdev;
+    }
+
+    if (!proc_create_seq("kxo_games", 0444, NULL, &games_seq_ops)) {
+        destroy_workqueue(kxo_workqueue);
         device_destroy(kxo_class, dev_id);
         class_destroy(kxo_class);
         ret = -ENOMEM;
@@ -483,17 +1558,22 @@ static int __init kxo_init(void)
 
     negamax_init();
     mcts_init();
-    memset(table, ' ', N_GRIDS);
-    turn = 'O';
-    finish = 1;
+    ret = negamax_state_init(&analysis_state);
+    if (ret) {
+        remove_proc_entry("kxo_games", NULL);
+        destroy_workqueue(kxo_workqueue);
+        device_destroy(kxo_class, dev_id);
+        class_destroy(kxo_class);
+        goto error_cdev;
+    }
 
     attr_obj.display = '1';
     attr_obj.resume = '1';
     attr_obj.end = '0';
     rwlock_init(&attr_obj.lock);
-    /* Setup the timer */
-    timer_setup(&timer, timer_handler, 0);
     atomic_set(&open_cnt, 0);
+    atomic_set(&game_ids, 0);
+    atomic_long_set(&dropped_pkgs, 0);
 
     pr_info("kxo: registered new kxo device: %d,%d\n", major, 0);
 out:
@@ -502,8 +1582,6 @@ error_cdev:
     cdev_del(&kxo_cdev);
 error_region:
     unregister_chrdev_region(dev_id, NR_KMLDRV);
-error_alloc:
-    kfifo_free(&rx_fifo);
     goto out;
 }
 
@@ -511,17 +1589,17 @@ static void __exit kxo_exit(void)
 {
     dev_t dev_id = MKDEV(major, 0);
 
-    del_timer_sync(&timer);
-    tasklet_kill(&game_tasklet);
+    remove_proc_entry("kxo_games", NULL);
+    /* Wait for the games released last to be freed */
+    rcu_barrier();
     flush_workqueue(kxo_workqueue);
     destroy_workqueue(kxo_workqueue);
-    vfree(fast_buf.buf);
+    negamax_state_destroy(&analysis_state);
     device_destroy(kxo_class, dev_id);
     class_destroy(kxo_class);
     cdev_del(&kxo_cdev);
     unregister_chrdev_region(dev_id, NR_KMLDRV);
 
-    kfifo_free(&rx_fifo);
     pr_info("kxo: unloaded\n");
 }
 
@@ -1,39 +1,52 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 
+#include "bitboard.h"
 #include "game.h"
 #include "mcts.h"
 #include "util.h"
 
+/* Children are allocated together, as one array holding exactly the legal
+ * moves, when their parent is expanded, so the memory used by the tree is
+ * proportional to the branching factor rather than to N_GRIDS.
+ */
 struct node {
-    int move;
-    char player;
+    struct node *parent;
+    struct node *children;
     int n_visits;
+    /* Sum of the playout values for the player who moved into this node */
     fixed_point_t score;
-    struct node *parent;
-    struct node *children[N_GRIDS];
+    /* All-moves-as-first statistics of the move, used by RAVE */
+    int amaf_visits;
+    fixed_point_t amaf_score;
+    s8 move;
+    char player;
+    u8 n_children;
 };
 
 static struct mcts_info mcts_obj;
 
-static struct node *new_node(int move, char player, struct node *parent)
+static void init_node(struct node *node,
+                      int move,
+                      char player,
+                      struct node *parent)
 {
-    struct node *node = kzalloc(sizeof(struct node), GFP_KERNEL);
-    node->move = move;
-    node->player = player;
+    node->parent = parent;
+    node->children = NULL;
     node->n_visits = 0;
     node->score = 0;
-    node->parent = parent;
-    memset(node->children, 0, sizeof(node->children));
-    return node;
+    node->amaf_visits = 0;
+    node->amaf_score = 0;
+    node->move = move;
+    node->player = player;
+    node->n_children = 0;
 }
 
-static void free_node(struct node *node)
+static void free_children(struct node *node)
 {
-    for (int i = 0; i < N_GRIDS; i++)
-        if (node->children[i])
-            free_node(node->children[i]);
-    kfree(node);
+    for (int i = 0; i < node->n_children; i++)
+        free_children(&node->children[i]);
+    kfree(node->children);
 }
 
 static fixed_point_t fixed_sqrt(fixed_point_t x)
@@ -85,132 +98,266 @@ static fixed_point_t fixed_log(fixed_point_t v)
 
 #define EXPLORATION_FACTOR fixed_sqrt(1U << (FIXED_SCALE_BITS + 1))
 
-static inline fixed_point_t uct_score(int n_total,
-                                      int n_visits,
-                                      fixed_point_t score)
+/* AMAF statistics already spread information over every move, so with RAVE
+ * the exploration term is scaled down by 2^RAVE_EXPLORATION_SHIFT.
+ */
+#define RAVE_EXPLORATION_SHIFT 4
+
+/* Mean playout value of @node for the player who moved into it. With RAVE,
+ * the AMAF value is blended in with weight sqrt(k / (3n + k)), so it dominates
+ * while the node has few visits of its own and fades out as they grow.
+ */
+static inline fixed_point_t node_value(const struct node *node, int rave)
+{
+    fixed_point_t value = node->score / node->n_visits;
+
+    if (!rave || !node->amaf_visits)
+        return value;
+
+    fixed_point_t amaf = node->amaf_score / node->amaf_visits;
+    fixed_point_t beta = fixed_sqrt(((fixed_point_t) rave << FIXED_SCALE_BITS) /
+                                    (3U * node->n_visits + rave));
+    return (((1U << FIXED_SCALE_BITS) - beta) * value + beta * amaf) >>
+           FIXED_SCALE_BITS;
+}
+
+/* @log_total is fixed_log() of the visits of the parent */
+static inline fixed_point_t uct_score(const struct node *node,
+                                      fixed_point_t log_total,
+                                      int rave)
 {
-    if (n_visits == 0)
+    if (node->n_visits == 0)
         return FIXED_MAX;
 
-    fixed_point_t result =
-        score << FIXED_SCALE_BITS /
-                     (fixed_point_t) (n_visits << FIXED_SCALE_BITS);
     fixed_point_t tmp =
-        EXPLORATION_FACTOR *
-        fixed_sqrt(fixed_log(n_total << FIXED_SCALE_BITS) / n_visits);
+        EXPLORATION_FACTOR * fixed_sqrt(log_total / node->n_visits);
     tmp >>= FIXED_SCALE_BITS;
-    return result + tmp;
+    if (rave)
+        tmp >>= RAVE_EXPLORATION_SHIFT;
+    return node_value(node, rave) + tmp;
 }
 
-static struct node *select_move(struct node *node)
+static struct node *select_move(struct node *node, int rave)
 {
     struct node *best_node = NULL;
     fixed_point_t best_score = 0U;
-    for (int i = 0; i < N_GRIDS; i++) {
-        if (!node->children[i])
-            continue;
-        fixed_point_t score =
-            uct_score(node->n_visits, node->children[i]->n_visits,
-                      node->children[i]->score);
-        if (score > best_score) {
+    fixed_point_t log_total = fixed_log(node->n_visits << FIXED_SCALE_BITS);
+
+    for (int i = 0; i < node->n_children; i++) {
+        struct node *child = &node->children[i];
+        fixed_point_t score = uct_score(child, log_total, rave);
+        if (!best_node || score > best_score) {
             best_score = score;
-            best_node = node->children[i];
+            best_node = child;
         }
     }
     return best_node;
 }
 
-static fixed_point_t simulate(const char *table, char player)
+/* Play one random game out on @board, @side (0 for O, 1 for X) moving
+ * first. @board is left holding the final position; the winner is returned,
+ * or 'D' for a draw.
+ */
+static char rollout(struct bitboard *board, int side, struct state_array *rng)
 {
-    char current_player = player;
-    char temp_table[N_GRIDS];
-    memcpy(temp_table, table, N_GRIDS);
-    xoro_jump(&(mcts_obj.xoro_obj));
+    u64 *marks[2] = {&board->o, &board->x};
+
     while (1) {
-        int *moves = available_moves(temp_table);
-        if (moves[0] == -1) {
-            kfree(moves);
-            break;
-        }
-        int n_moves = 0;
-        while (n_moves < N_GRIDS && moves[n_moves] != -1)
-            ++n_moves;
-        int move = moves[xoro_next(&(mcts_obj.xoro_obj)) % n_moves];
-        kfree(moves);
-        temp_table[move] = current_player;
-        char win;
-        if ((win = check_win(temp_table)) != ' ')
-            return calculate_win_value(win, player);
-        current_player ^= 'O' ^ 'X';
+        u64 empty = bitboard_empty(board);
+        if (!empty)
+            return 'D';
+        int n_moves = hweight64(empty);
+        int move = bitboard_nth(empty, xoro_next(rng) % n_moves);
+        *marks[side] |= 1ULL << move;
+        if (bitboard_wins_at(*marks[side], move))
+            return side ? 'X' : 'O';
+        side ^= 1;
+    }
+}
+
+fixed_point_t simulate_batch(const char *table, char player, int n)
+{
+    struct bitboard board;
+    fixed_point_t sum = 0;
+
+    bitboard_from_table(&board, table);
+    xoro_jump(&(mcts_obj.xoro_obj));
+    for (int i = 0; i < n; i++) {
+        struct bitboard end = board;
+        char win = rollout(&end, player == 'X', &(mcts_obj.xoro_obj));
+        sum += calculate_win_value(win, player);
     }
-    return (fixed_point_t) (1UL << (FIXED_SCALE_BITS - 1));
+    return sum;
+}
+
+fixed_point_t simulate(const char *table, char player)
+{
+    return simulate_batch(table, player, 1);
 }
 
-static void backpropagate(struct node *node, fixed_point_t score)
+/* Account for @n_visits playouts worth @score in total, from @node up */
+static void backpropagate(struct node *node,
+                          fixed_point_t score,
+                          int n_visits)
 {
     while (node) {
-        node->n_visits++;
+        node->n_visits += n_visits;
         node->score += score;
         node = node->parent;
-        score = 1 - score;
+        score = (n_visits << FIXED_SCALE_BITS) - score;
+    }
+}
+
+/* Credit a playout which went from @board at @node to @end, and was won by
+ * @win, to every move the side to move at @node or at one of its ancestors
+ * could have played there and did play later on.
+ */
+static void update_amaf(struct node *node,
+                        struct bitboard board,
+                        const struct bitboard *end,
+                        char win)
+{
+    for (; node; node = node->parent) {
+        u64 played = node->player == 'X' ? end->x & ~board.x
+                                         : end->o & ~board.o;
+        fixed_point_t value = calculate_win_value(win, node->player);
+
+        for (int i = 0; i < node->n_children; i++) {
+            struct node *child = &node->children[i];
+            if (played & (1ULL << child->move)) {
+                child->amaf_visits++;
+                child->amaf_score += value;
+            }
+        }
+        if (node->move >= 0) {
+            u64 *marks = node->player == 'X' ? &board.o : &board.x;
+            *marks &= ~(1ULL << node->move);
+        }
     }
 }
 
-static int expand(struct node *node, const char *table)
+/* Run @n playouts from the new leaf @node, holding @board, and return their
+ * summed value for the player who moved into it.
+ */
+static fixed_point_t playout(struct node *node,
+                             const struct bitboard *board,
+                             int n,
+                             int rave,
+                             struct state_array *rng)
 {
-    int *moves = available_moves(table);
-    int n_moves = 0;
-    while (n_moves < N_GRIDS && moves[n_moves] != -1)
-        ++n_moves;
-    for (int i = 0; i < n_moves; i++) {
-        node->children[i] = new_node(moves[i], node->player ^ 'O' ^ 'X', node);
+    char mover = node->player ^ 'O' ^ 'X';
+    fixed_point_t sum = 0;
+
+    xoro_jump(rng);
+    for (int i = 0; i < n; i++) {
+        struct bitboard end = *board;
+        char win = rollout(&end, node->player == 'X', rng);
+        sum += calculate_win_value(win, mover);
+        if (rave)
+            update_amaf(node, *board, &end, win);
     }
-    kfree(moves);
+    return sum;
+}
+
+static int expand(struct node *node, const struct bitboard *board, gfp_t gfp)
+{
+    u64 empty = bitboard_empty(board);
+    int n_moves = hweight64(empty);
+
+    node->children = kcalloc(n_moves, sizeof(struct node), gfp);
+    if (!node->children)
+        return 0;
+    for (int i = 0; empty; empty &= empty - 1, i++)
+        init_node(&node->children[i], __ffs64(empty),
+                  node->player ^ 'O' ^ 'X', node);
+    node->n_children = n_moves;
     return n_moves;
 }
 
-int mcts(const char *table, char player)
+int mcts_search_r(const char *table,
+                  char player,
+                  const struct mcts_config *config,
+                  struct mcts_info *info,
+                  fixed_point_t *value)
 {
     char win;
-    struct node *root = new_node(-1, player, NULL);
-    mcts_obj.nr_active_nodes = 1;
-    for (int i = 0; i < ITERATIONS; i++) {
-        struct node *node = root;
-        char temp_table[N_GRIDS];
-        memcpy(temp_table, table, N_GRIDS);
+    struct node root;
+    struct bitboard start;
+    int best_move = -1;
+
+    int n_rollouts = config->rollouts > 1 ? config->rollouts : 1;
+    int rave = config->rave > 0 ? config->rave : 0;
+    gfp_t gfp = config->account ? GFP_KERNEL_ACCOUNT : GFP_KERNEL;
+
+    bitboard_from_table(&start, table);
+    init_node(&root, -1, player, NULL);
+    info->nr_active_nodes = 1;
+    for (int i = 0; i < config->iterations; i++) {
+        struct node *node = &root;
+        struct bitboard board = start;
         while (1) {
-            if ((win = check_win(temp_table)) != ' ') {
+            if ((win = check_win_bitboard(&board)) != ' ') {
                 fixed_point_t score =
                     calculate_win_value(win, node->player ^ 'O' ^ 'X');
-                backpropagate(node, score);
+                backpropagate(node, score, 1);
+                if (rave)
+                    update_amaf(node, board, &board, win);
                 break;
             }
             if (node->n_visits == 0) {
-                fixed_point_t score = simulate(temp_table, node->player);
-                backpropagate(node, score);
+                fixed_point_t score = playout(node, &board, n_rollouts, rave,
+                                              &info->xoro_obj);
+                backpropagate(node, score, n_rollouts);
                 break;
             }
-            if (node->children[0] == NULL)
-                mcts_obj.nr_active_nodes += expand(node, temp_table);
-            node = select_move(node);
+            if (!node->children)
+                info->nr_active_nodes += expand(node, &board, gfp);
+            node = select_move(node, rave);
             if (!node)
-                return -1;
-            temp_table[node->move] = node->player ^ 'O' ^ 'X';
+                goto out;
+            if (node->player == 'X')
+                board.o |= 1ULL << node->move;
+            else
+                board.x |= 1ULL << node->move;
         }
     }
-    struct node *best_node = root;
     int most_visits = -1;
-    for (int i = 0; i < N_GRIDS; i++) {
-        if (root->children[i] && root->children[i]->n_visits > most_visits) {
-            most_visits = root->children[i]->n_visits;
-            best_node = root->children[i];
+    for (int i = 0; i < root.n_children; i++) {
+        const struct node *child = &root.children[i];
+        if (child->n_visits > most_visits) {
+            most_visits = child->n_visits;
+            best_move = child->move;
+            if (value)
+                *value = child->n_visits ? child->score / child->n_visits : 0;
         }
     }
-    int best_move = best_node->move;
-    free_node(root);
+out:
+    free_children(&root);
     return best_move;
 }
 
+int mcts_search(const char *table,
+                char player,
+                const struct mcts_config *config)
+{
+    return mcts_search_r(table, player, config, &mcts_obj, NULL);
+}
+
+int mcts(const char *table, char player)
+{
+    static const struct mcts_config config = {
+        .iterations = ITERATIONS,
+        .rollouts = 1,
+        .rave = 0,
+    };
+    return mcts_search(table, player, &config);
+}
+
+int mcts_nr_active_nodes(void)
+{
+    return mcts_obj.nr_active_nodes;
+}
+
 void mcts_init(void)
 {
     xoro_init(&(mcts_obj.xoro_obj));
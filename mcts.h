@@ -1,13 +1,61 @@
 #pragma once
 
+#include "game.h"
 #include "xoroshiro.h"
 
+#ifndef ITERATIONS
 #define ITERATIONS 100000
+#endif
 
 struct mcts_info {
     struct state_array xoro_obj;
     int nr_active_nodes;
 };
 
+/* Upper bound for mcts_config.rollouts accepted from userspace */
+#define MCTS_MAX_ROLLOUTS 64
+
+/* Tunables of a single search, see mcts_search() */
+struct mcts_config {
+    int iterations;
+    /* Playouts run from every new leaf, and backpropagated together */
+    int rollouts;
+    /* RAVE equivalence parameter: tree and all-moves-as-first values weigh
+     * the same once a node has this many visits. 0 selects plain UCT.
+     */
+    int rave;
+    /* Charge the tree to the memory cgroup being allocated for, searches run
+     * on behalf of userspace setting it
+     */
+    bool account;
+};
+
 int mcts(const char *table, char player);
+int mcts_search(const char *table,
+                char player,
+                const struct mcts_config *config);
 void mcts_init(void);
+
+/* Same as mcts_search(), but drawing playouts from @info instead of the
+ * shared state, so that searches with their own @info may run concurrently.
+ * If @value is not NULL, it receives the average value of the chosen move
+ * for @player, 1 << FIXED_SCALE_BITS being a win.
+ */
+int mcts_search_r(const char *table,
+                  char player,
+                  const struct mcts_config *config,
+                  struct mcts_info *info,
+                  fixed_point_t *value);
+
+/* Play one random game out from @table with @player to move, and return its
+ * value from the point of view of @player.
+ */
+fixed_point_t simulate(const char *table, char player);
+
+/* Play @n random games out from @table, back to back on bitboards, and
+ * return the sum of their values from the point of view of @player.
+ */
+fixed_point_t simulate_batch(const char *table, char player, int n);
+
+/* Number of tree nodes allocated by the last call to mcts() */
+int mcts_nr_active_nodes(void);
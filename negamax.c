@@ -1,5 +1,5 @@
+#include <linux/errno.h>
 #include <linux/slab.h>
-#include <linux/sort.h>
 #include <linux/string.h>
 
 #include "game.h"
@@ -7,93 +7,149 @@
 #include "util.h"
 #include "zobrist.h"
 
-#define MAX_SEARCH_DEPTH 6
+/* Bound of the scores of the search, beyond those of get_score(): a won
+ * segment scoring 10^(GOAL - 1), game.h limits GOAL accordingly.
+ */
+#define NEGAMAX_WINDOW 100000
 
-static int history_score_sum[N_GRIDS];
-static int history_count[N_GRIDS];
+/* State of negamax_predict() and the other callers without a state of their
+ * own
+ */
+static struct negamax_state global_state;
 
-static u64 hash_value;
+static int history_score(const struct negamax_state *state, int move)
+{
+    if (!state->history_count[move])
+        return 0;
+    return state->history_score_sum[move] / state->history_count[move];
+}
 
-static int cmp_moves(const void *a, const void *b)
+/* Order @moves by decreasing average score in the history of @state. There
+ * are at most N_GRIDS of them, and sort() passes no context to the
+ * comparison, so insertion-sort them by their precomputed scores.
+ */
+static void order_moves(const struct negamax_state *state, int *moves, int n)
 {
-    const int *_a = (int *) a, *_b = (int *) b;
-    int score_a = 0, score_b = 0;
-
-    if (history_count[*_a])
-        score_a = history_score_sum[*_a] / history_count[*_a];
-    if (history_count[*_b])
-        score_b = history_score_sum[*_b] / history_count[*_b];
-    return score_b - score_a;
+    int scores[N_GRIDS];
+
+    for (int i = 0; i < n; i++) {
+        int move = moves[i], score = history_score(state, move), j;
+
+        for (j = i; j > 0 && scores[j - 1] < score; j--) {
+            scores[j] = scores[j - 1];
+            moves[j] = moves[j - 1];
+        }
+        scores[j] = score;
+        moves[j] = move;
+    }
 }
 
-static move_t negamax(char *table, int depth, char player, int alpha, int beta)
+static move_t negamax(struct negamax_state *state,
+                      char *table,
+                      int depth,
+                      char player,
+                      int alpha,
+                      int beta)
 {
+    state->nr_nodes++;
     if (check_win(table) != ' ' || depth == 0) {
         move_t result = {get_score(table, player), -1};
         return result;
     }
-    const zobrist_entry_t *entry = zobrist_get(hash_value);
+    const zobrist_entry_t *entry =
+        zobrist_get(state->hash_table, state->hash_value);
     if (entry)
         return (move_t){.score = entry->score, .move = entry->move};
 
     int score;
-    move_t best_move = {-10000, -1};
-    int *moves = available_moves(table);
-    int n_moves = 0;
-    while (n_moves < N_GRIDS && moves[n_moves] != -1)
-        ++n_moves;
+    move_t best_move = {-NEGAMAX_WINDOW, -1};
+    int moves[N_GRIDS];
+    int n_moves = available_moves(table, moves);
+    char opponent = player == 'X' ? 'O' : 'X';
 
-    sort(moves, n_moves, sizeof(int), cmp_moves, NULL);
+    order_moves(state, moves, n_moves);
 
     for (int i = 0; i < n_moves; i++) {
         table[moves[i]] = player;
-        hash_value ^= zobrist_table[moves[i]][player == 'X'];
+        state->hash_value ^= zobrist_table[moves[i]][player == 'X'];
         if (!i)
-            score = -negamax(table, depth - 1, player == 'X' ? 'O' : 'X', -beta,
-                             -alpha)
-                         .score;
+            score =
+                -negamax(state, table, depth - 1, opponent, -beta, -alpha)
+                     .score;
         else {
-            score = -negamax(table, depth - 1, player == 'X' ? 'O' : 'X',
-                             -alpha - 1, -alpha)
+            score = -negamax(state, table, depth - 1, opponent, -alpha - 1,
+                             -alpha)
                          .score;
             if (alpha < score && score < beta)
-                score = -negamax(table, depth - 1, player == 'X' ? 'O' : 'X',
-                                 -beta, -score)
+                score = -negamax(state, table, depth - 1, opponent, -beta,
+                                 -score)
                              .score;
         }
-        history_count[moves[i]]++;
-        history_score_sum[moves[i]] += score;
+        state->history_count[moves[i]]++;
+        state->history_score_sum[moves[i]] += score;
         if (score > best_move.score) {
             best_move.score = score;
             best_move.move = moves[i];
         }
         table[moves[i]] = ' ';
-        hash_value ^= zobrist_table[moves[i]][player == 'X'];
+        state->hash_value ^= zobrist_table[moves[i]][player == 'X'];
         if (score > alpha)
             alpha = score;
         if (alpha >= beta)
             break;
     }
 
-    kfree((char *) moves);
-    zobrist_put(hash_value, best_move.score, best_move.move);
+    zobrist_put(state->hash_table, state->hash_value, best_move.score,
+                best_move.move);
     return best_move;
 }
 
+int negamax_state_init(struct negamax_state *state)
+{
+    memset(state, 0, sizeof(*state));
+    state->hash_table = zobrist_alloc();
+    return state->hash_table ? 0 : -ENOMEM;
+}
+
+void negamax_state_destroy(struct negamax_state *state)
+{
+    zobrist_free(state->hash_table);
+    state->hash_table = NULL;
+}
+
 void negamax_init(void)
 {
     zobrist_init();
-    hash_value = 0;
+    negamax_state_init(&global_state);
 }
 
-move_t negamax_predict(char *table, char player)
+move_t negamax_predict_depth_r(struct negamax_state *state,
+                               char *table,
+                               char player,
+                               int max_depth)
 {
-    memset(history_score_sum, 0, sizeof(history_score_sum));
-    memset(history_count, 0, sizeof(history_count));
-    move_t result;
-    for (int depth = 2; depth <= MAX_SEARCH_DEPTH; depth += 2) {
-        result = negamax(table, depth, player, -100000, 100000);
-        zobrist_clear();
+    memset(state->history_score_sum, 0, sizeof(state->history_score_sum));
+    memset(state->history_count, 0, sizeof(state->history_count));
+    move_t result = {.score = 0, .move = -1};
+    for (int depth = 2; depth <= max_depth; depth += 2) {
+        result = negamax(state, table, depth, player, -NEGAMAX_WINDOW,
+                         NEGAMAX_WINDOW);
+        zobrist_clear(state->hash_table);
     }
     return result;
 }
+
+move_t negamax_predict_depth(char *table, char player, int max_depth)
+{
+    return negamax_predict_depth_r(&global_state, table, player, max_depth);
+}
+
+move_t negamax_predict(char *table, char player)
+{
+    return negamax_predict_depth(table, player, MAX_SEARCH_DEPTH);
+}
+
+unsigned long negamax_nr_nodes(void)
+{
+    return global_state.nr_nodes;
+}
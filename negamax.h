@@ -1,8 +1,59 @@
 #pragma once
 
+#include "game.h"
+
+/* Deepest iteration of negamax_predict(); the branching factor grows with the
+ * board, so larger boards are searched less deep by default.
+ */
+#ifndef MAX_SEARCH_DEPTH
+#if N_GRIDS <= 16
+#define MAX_SEARCH_DEPTH 6
+#else
+#define MAX_SEARCH_DEPTH 4
+#endif
+#endif
+
 typedef struct {
     int score, move;
 } move_t;
 
+struct hlist_head;
+
+/* Move ordering history, position hash and transposition table of a search,
+ * so that searches with their own state may run concurrently
+ */
+struct negamax_state {
+    int history_score_sum[N_GRIDS];
+    int history_count[N_GRIDS];
+    u64 hash_value;
+    unsigned long nr_nodes;
+    struct hlist_head *hash_table;
+};
+
 void negamax_init(void);
 move_t negamax_predict(char *table, char player);
+
+/* Same as negamax_predict(), but deepening two plies at a time up to
+ * @max_depth plies. With @max_depth below 2, no move is searched and the
+ * move returned is -1.
+ */
+move_t negamax_predict_depth(char *table, char player, int max_depth);
+
+/* Set up @state for negamax_predict_depth_r(), allocating its transposition
+ * table. Returns 0 or -ENOMEM. negamax_init() must have been called first.
+ */
+int negamax_state_init(struct negamax_state *state);
+void negamax_state_destroy(struct negamax_state *state);
+
+/* Same as negamax_predict_depth(), but searching with @state instead of the
+ * shared one
+ */
+move_t negamax_predict_depth_r(struct negamax_state *state,
+                               char *table,
+                               char player,
+                               int max_depth);
+
+/* Number of positions visited by negamax since negamax_init(), searches with
+ * a state of their own aside
+ */
+unsigned long negamax_nr_nodes(void);
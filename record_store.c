@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "record_store.h"
+
+/* Records the store has room for after its first allocation */
+#define RECORD_STORE_MIN_CAP 1024
+
+void record_store_init(struct record_store *store)
+{
+    store->records = NULL;
+    store->n = store->cap = 0;
+}
+
+void record_store_free(struct record_store *store)
+{
+    free(store->records);
+    record_store_init(store);
+}
+
+/* Double the capacity, so appends cost amortized O(1) */
+static bool record_store_grow(struct record_store *store)
+{
+    size_t cap = store->cap ? store->cap * 2 : RECORD_STORE_MIN_CAP;
+    struct record *records = realloc(store->records, cap * sizeof(*records));
+
+    if (!records)
+        return false;
+    store->records = records;
+    store->cap = cap;
+    return true;
+}
+
+void record_pack(struct record *record,
+                 const int *moves,
+                 int len,
+                 char winner)
+{
+    memset(record, 0, sizeof(*record));
+    record->len = len;
+    record->winner = winner;
+    for (int i = 0; i < len; i++) {
+        int bit = i * RECORD_MOVE_BITS;
+        int window = moves[i] << (bit % 8);
+        record->moves[bit / 8] |= window & 0xff;
+        record->moves[bit / 8 + 1] |= window >> 8;
+    }
+}
+
+struct record *record_store_append(struct record_store *store,
+                                   const int *moves,
+                                   int len,
+                                   char winner)
+{
+    if (store->n == store->cap && !record_store_grow(store))
+        return NULL;
+
+    struct record *record = &store->records[store->n++];
+    record_pack(record, moves, len, winner);
+    return record;
+}
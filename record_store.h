@@ -0,0 +1,103 @@
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+/* This program implements a compact store of finished games.
+ *
+ * Every game is kept as a fixed-size record, with its moves bit-packed, in
+ * one contiguous array which grows geometrically. Appending a game costs no
+ * allocation of its own, and the records are walked sequentially.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/* Bits needed to hold a square index */
+#define RECORD_MOVE_BITS (N_GRIDS <= 16 ? 4 : 6)
+
+/* One spare byte lets record_get_move() always read two bytes */
+#define RECORD_MOVE_BYTES ((N_GRIDS * RECORD_MOVE_BITS + 7) / 8 + 1)
+
+/**
+ * struct record - One finished game
+ * @len: number of moves played
+ * @winner: 'O', 'X' or 'D' for a draw
+ * @moves: square of every move, RECORD_MOVE_BITS each, packed from bit 0
+ */
+struct record {
+    uint8_t len;
+    char winner;
+    uint8_t moves[RECORD_MOVE_BYTES];
+};
+
+/**
+ * struct record_store - Growable array of records
+ * @records: storage for @cap records, the first @n of which are in use
+ * @n: number of records stored
+ * @cap: number of records @records has room for
+ */
+struct record_store {
+    struct record *records;
+    size_t n, cap;
+};
+
+/**
+ * record_store_init() - Create an empty store
+ * @store: store to initialize
+ */
+void record_store_init(struct record_store *store);
+
+/**
+ * record_store_free() - Free all storage used by the store
+ * @store: store to free, left empty
+ */
+void record_store_free(struct record_store *store);
+
+/**
+ * record_pack() - Fill in a record
+ * @record: record to fill in
+ * @moves: squares played, in order
+ * @len: number of moves, at most N_GRIDS
+ * @winner: 'O', 'X' or 'D' for a draw
+ */
+void record_pack(struct record *record,
+                 const int *moves,
+                 int len,
+                 char winner);
+
+/**
+ * record_store_append() - Append a finished game
+ * @store: store to append to
+ * @moves: squares played, in order
+ * @len: number of moves, at most N_GRIDS
+ * @winner: 'O', 'X' or 'D' for a draw
+ *
+ * Return: the stored record, NULL if the store could not grow
+ */
+struct record *record_store_append(struct record_store *store,
+                                   const int *moves,
+                                   int len,
+                                   char winner);
+
+/**
+ * record_get_move() - Square of the @i-th move of @record
+ */
+static inline int record_get_move(const struct record *record, int i)
+{
+    int bit = i * RECORD_MOVE_BITS;
+    int window = record->moves[bit / 8] | (record->moves[bit / 8 + 1] << 8);
+    return (window >> (bit % 8)) & ((1 << RECORD_MOVE_BITS) - 1);
+}
+
+/**
+ * record_store_for_each() - Iterate over the records in insertion order
+ * @record: struct record pointer used as iterator
+ * @store: store to iterate over
+ */
+#define record_store_for_each(record, store)               \
+    for (record = (store)->records;                        \
+         record < (store)->records + (store)->n; record++)
+
+#endif /* RECORD_STORE_H */
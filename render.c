@@ -0,0 +1,152 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "render.h"
+
+#define DEFAULT_ROWS 24
+#define DEFAULT_COLS 80
+
+/* Unchanged cells shorter than this between two changed runs are rewritten
+ * rather than skipped with another escape sequence.
+ */
+#define MIN_GAP 8
+
+/* Longest cursor-addressing sequence, "\033[row;colH" */
+#define MAX_ESCAPE 16
+
+int screen_init(struct screen *s)
+{
+    struct winsize ws;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row &&
+        ws.ws_col) {
+        s->rows = ws.ws_row;
+        s->cols = ws.ws_col;
+    } else {
+        s->rows = DEFAULT_ROWS;
+        s->cols = DEFAULT_COLS;
+    }
+
+    size_t n = (size_t) s->rows * s->cols;
+    s->cells = malloc(n);
+    s->drawn = malloc(n);
+    /* Worst case: an escape sequence for every cell */
+    s->out_size = n * (MAX_ESCAPE + 1) + MAX_ESCAPE;
+    s->out = malloc(s->out_size);
+    if (!s->cells || !s->drawn || !s->out) {
+        screen_free(s);
+        return -1;
+    }
+    screen_clear(s);
+    s->valid = false;
+    return 0;
+}
+
+void screen_free(struct screen *s)
+{
+    free(s->cells);
+    free(s->drawn);
+    free(s->out);
+    s->cells = s->drawn = s->out = NULL;
+}
+
+void screen_clear(struct screen *s)
+{
+    memset(s->cells, ' ', (size_t) s->rows * s->cols);
+}
+
+void screen_put(struct screen *s, int row, int col, const char *text)
+{
+    for (int c = col; *text; text++) {
+        if (*text == '\n') {
+            row++;
+            c = col;
+            continue;
+        }
+        if (row >= 0 && row < s->rows && c >= 0 && c < s->cols)
+            s->cells[row * s->cols + c] = *text;
+        c++;
+    }
+}
+
+void screen_invalidate(struct screen *s)
+{
+    s->valid = false;
+}
+
+/* Append the escape sequence formatted from @fmt at *@out, moving it past the
+ * sequence, or return false if the sequence does not fit before @end
+ */
+static bool put_escape(char **out, const char *end, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(*out, end - *out, fmt, ap);
+    va_end(ap);
+    if (len < 0 || len >= end - *out)
+        return false;
+    *out += len;
+    return true;
+}
+
+int screen_flush(struct screen *s)
+{
+    char *out = s->out;
+    /* Sized for the worst case in screen_init(), so never truncated */
+    const char *out_end = s->out + s->out_size;
+
+    if (!s->valid) {
+        /* Start over from a blank terminal */
+        if (!put_escape(&out, out_end, "\033[H\033[J"))
+            goto overflow;
+        memset(s->drawn, ' ', (size_t) s->rows * s->cols);
+        s->valid = true;
+    }
+
+    for (int r = 0; r < s->rows; r++) {
+        const char *cells = s->cells + r * s->cols;
+        char *drawn = s->drawn + r * s->cols;
+        int c = 0;
+
+        while (c < s->cols) {
+            if (cells[c] == drawn[c]) {
+                c++;
+                continue;
+            }
+            /* Extend the run over changed cells and short unchanged gaps */
+            int end = c + 1, last = c;
+            while (end < s->cols && end - last <= MIN_GAP) {
+                if (cells[end] != drawn[end])
+                    last = end;
+                end++;
+            }
+            if (!put_escape(&out, out_end, "\033[%d;%dH", r + 1, c + 1))
+                goto overflow;
+            memcpy(out, cells + c, last + 1 - c);
+            memcpy(drawn + c, cells + c, last + 1 - c);
+            out += last + 1 - c;
+            c = last + 1;
+        }
+    }
+
+    size_t len = out - s->out;
+    for (size_t done = 0; done < len;) {
+        ssize_t n = write(STDOUT_FILENO, s->out + done, len - done);
+        if (n < 0)
+            return -1;
+        done += n;
+    }
+    return len;
+
+overflow:
+    /* @drawn no longer matches the terminal */
+    s->valid = false;
+    errno = ENOBUFS;
+    return -1;
+}
@@ -0,0 +1,81 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+/* Differential terminal rendering.
+ *
+ * Frames are composed into a grid of character cells. Flushing a frame
+ * compares it with the last one drawn and writes only the runs of cells
+ * which changed, each prefixed by a cursor-addressing escape sequence, with a
+ * single write() to the terminal.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * struct screen - Frame being composed and the last frame drawn
+ * @rows: height of the terminal
+ * @cols: width of the terminal
+ * @cells: frame being composed, @rows * @cols characters
+ * @drawn: what the terminal shows, valid only if @valid
+ * @valid: false until the first flush, or after the terminal was written to
+ *         behind the renderer's back
+ * @out: escape sequences and characters of the next write()
+ * @out_size: bytes allocated for @out, enough for an escape sequence before
+ *            every cell
+ */
+struct screen {
+    int rows, cols;
+    char *cells;
+    char *drawn;
+    bool valid;
+    char *out;
+    size_t out_size;
+};
+
+/**
+ * screen_init() - Set up a screen the size of the terminal on stdout
+ * @s: screen to set up
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+int screen_init(struct screen *s);
+
+/**
+ * screen_free() - Free the buffers of a screen
+ * @s: screen to free
+ */
+void screen_free(struct screen *s);
+
+/**
+ * screen_clear() - Blank the frame being composed
+ * @s: screen to blank
+ */
+void screen_clear(struct screen *s);
+
+/**
+ * screen_put() - Copy text into the frame being composed
+ * @s: screen to draw on
+ * @row: row of the first character
+ * @col: column of the first character of every line
+ * @text: NUL-terminated text, where '\n' moves to the next row
+ *
+ * Text falling outside of the screen is clipped.
+ */
+void screen_put(struct screen *s, int row, int col, const char *text);
+
+/**
+ * screen_invalidate() - Redraw everything on the next flush
+ * @s: screen whose terminal was written to by someone else
+ */
+void screen_invalidate(struct screen *s);
+
+/**
+ * screen_flush() - Bring the terminal up to date with the composed frame
+ * @s: screen to flush
+ *
+ * Return: bytes written to the terminal, -1 with errno set on error
+ */
+int screen_flush(struct screen *s);
+
+#endif /* RENDER_H */
@@ -0,0 +1,169 @@
+/* gen-tables: emit the board tables used by the game engines
+ *
+ * Usage: gen-tables BOARD_SIZE GOAL ALLOW_EXCEED > game_tables.h
+ *
+ * Every GOAL-in-a-row segment of the board is listed once, in the order the
+ * engines scan them (columns, rows, primary then secondary diagonals), so the
+ * hot loops of check_win() and get_score() run over compile-time constants
+ * instead of walking line descriptors with runtime bounds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_BOARD_SIZE 8
+/* A won segment scores 10^(GOAL - 1), see game.h */
+#define MAX_GOAL 5
+#define MAX_SEGMENTS (4 * MAX_BOARD_SIZE * MAX_BOARD_SIZE)
+
+struct segment {
+    int squares[MAX_BOARD_SIZE];
+    int before, after; /* neighbours extending the segment, -1 if none */
+};
+
+static int board_size, goal, allow_exceed;
+static struct segment segments[MAX_SEGMENTS];
+static int n_segments;
+
+static int square(int i, int j)
+{
+    if (i < 0 || i >= board_size || j < 0 || j >= board_size)
+        return -1;
+    return i * board_size + j;
+}
+
+static void add_segments(int i_shift, int j_shift)
+{
+    for (int i = 0; i < board_size; i++) {
+        for (int j = 0; j < board_size; j++) {
+            struct segment *s = &segments[n_segments];
+            if (square(i + (goal - 1) * i_shift, j + (goal - 1) * j_shift) < 0)
+                continue;
+            for (int k = 0; k < goal; k++)
+                s->squares[k] = square(i + k * i_shift, j + k * j_shift);
+            s->before = square(i - i_shift, j - j_shift);
+            s->after = square(i + goal * i_shift, j + goal * j_shift);
+            n_segments++;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s BOARD_SIZE GOAL ALLOW_EXCEED\n", argv[0]);
+        return 1;
+    }
+    board_size = atoi(argv[1]);
+    goal = atoi(argv[2]);
+    allow_exceed = atoi(argv[3]);
+    if (board_size > MAX_BOARD_SIZE || goal < 2 || goal > board_size ||
+        goal > MAX_GOAL) {
+        fprintf(stderr,
+                "%s: need 2 <= GOAL <= BOARD_SIZE <= %d and GOAL <= %d\n",
+                argv[0], MAX_BOARD_SIZE, MAX_GOAL);
+        return 1;
+    }
+
+    int n_grids = board_size * board_size;
+    add_segments(1, 0);  /* columns */
+    add_segments(0, 1);  /* rows */
+    add_segments(1, 1);  /* primary diagonals */
+    add_segments(1, -1); /* secondary diagonals */
+
+    int n_square_segments[MAX_BOARD_SIZE * MAX_BOARD_SIZE] = {0};
+    int max_square_segments = 0;
+    for (int s = 0; s < n_segments; s++) {
+        for (int k = 0; k < goal; k++) {
+            int n = ++n_square_segments[segments[s].squares[k]];
+            if (n > max_square_segments)
+                max_square_segments = n;
+        }
+    }
+
+    printf("/* Generated by scripts/gen-tables.c for a %dx%d board, GOAL %d, "
+           "ALLOW_EXCEED %d.\n * Do not edit.\n */\n\n",
+           board_size, board_size, goal, allow_exceed);
+    printf("#pragma once\n\n");
+    printf("#if BOARD_SIZE != %d || GOAL != %d || ALLOW_EXCEED != %d\n",
+           board_size, goal, allow_exceed);
+    printf("#error \"game_tables.h was generated for another board\"\n");
+    printf("#endif\n\n");
+    printf("#define N_SEGMENTS %d\n", n_segments);
+    printf("#define MAX_SQUARE_SEGMENTS %d\n\n", max_square_segments);
+    printf("/* Fully unroll the following loop over all segments */\n");
+    printf("#define UNROLL_SEGMENTS _Pragma(\"GCC unroll %d\")\n\n",
+           n_segments);
+
+    printf("/* Squares of every GOAL-in-a-row segment */\n");
+    printf("static const u8 segment_squares[N_SEGMENTS][GOAL] = {\n");
+    for (int s = 0; s < n_segments; s++) {
+        printf("    {");
+        for (int k = 0; k < goal; k++)
+            printf("%s%d", k ? ", " : "", segments[s].squares[k]);
+        printf("},\n");
+    }
+    printf("};\n\n");
+
+    printf("/* Bitmask of the squares of every segment */\n");
+    printf("static const u64 segment_masks[N_SEGMENTS] = {\n");
+    for (int s = 0; s < n_segments; s++) {
+        unsigned long long mask = 0;
+        for (int k = 0; k < goal; k++)
+            mask |= 1ULL << segments[s].squares[k];
+        printf("    0x%016llxULL,\n", mask);
+    }
+    printf("};\n\n");
+
+    printf("/* Squares right before and after every segment, -1 if off the\n"
+           " * board. A stone of the same colour there makes the line longer\n"
+           " * than GOAL, which does not count unless ALLOW_EXCEED is set.\n"
+           " */\n");
+    printf("static const s8 segment_guards[N_SEGMENTS][2] = {\n");
+    for (int s = 0; s < n_segments; s++)
+        printf("    {%d, %d},\n", segments[s].before, segments[s].after);
+    printf("};\n\n");
+
+    printf("/* Bitmask of segment_guards[] */\n");
+    printf("static const u64 segment_guard_masks[N_SEGMENTS] = {\n");
+    for (int s = 0; s < n_segments; s++) {
+        unsigned long long mask = 0;
+        if (segments[s].before >= 0)
+            mask |= 1ULL << segments[s].before;
+        if (segments[s].after >= 0)
+            mask |= 1ULL << segments[s].after;
+        printf("    0x%016llxULL,\n", mask);
+    }
+    printf("};\n\n");
+
+    printf("/* Segments going through every square */\n");
+    printf("static const u8 square_n_segments[%d] = {\n   ", n_grids);
+    for (int i = 0; i < n_grids; i++)
+        printf(" %d,", n_square_segments[i]);
+    printf("\n};\n\n");
+    printf("static const u8 "
+           "square_segments[%d][MAX_SQUARE_SEGMENTS] = {\n",
+           n_grids);
+    for (int i = 0; i < n_grids; i++) {
+        int first = 1;
+        printf("    {");
+        for (int s = 0; s < n_segments; s++) {
+            for (int k = 0; k < goal; k++) {
+                if (segments[s].squares[k] != i)
+                    continue;
+                printf("%s%d", first ? "" : ", ", s);
+                first = 0;
+            }
+        }
+        printf("},\n");
+    }
+    printf("};\n\n");
+
+    printf("/* Evaluation of a segment holding n stones of a single colour,\n"
+           " * see get_score()\n */\n");
+    printf("static const int segment_scores[GOAL + 1] = {0");
+    for (int n = 1, score = 1; n <= goal; n++, score *= 10)
+        printf(", %d", score);
+    printf("};\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+
+#include "stats.h"
+
+void stats_interval(struct game_stats *st, unsigned long long ns)
+{
+    unsigned long long us = ns / 1000;
+    int bucket = 0;
+
+    while (us && bucket < LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    st->latency[bucket]++;
+    st->n_latency++;
+}
+
+void stats_game(struct game_stats *st, char result, int len)
+{
+    st->games++;
+    st->game_moves += len;
+    if (result == 'O')
+        st->o_wins++;
+    else if (result == 'X')
+        st->x_wins++;
+    else
+        st->draws++;
+}
+
+unsigned long long stats_percentile(const struct game_stats *st, int p)
+{
+    unsigned long long seen = 0;
+
+    if (!st->n_latency)
+        return 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += st->latency[i];
+        if (seen * 100 >= st->n_latency * p)
+            return 1ULL << i;
+    }
+    return 1ULL << (LATENCY_BUCKETS - 1);
+}
+
+static double percent(unsigned long long n, unsigned long long total)
+{
+    return total ? 100.0 * n / total : 0.0;
+}
+
+void stats_format(char *buf,
+                  size_t size,
+                  const struct game_stats *st,
+                  const struct game_stats *prev,
+                  double elapsed)
+{
+    snprintf(buf, size,
+             "%.0f moves/s %.1f games/s | O %.1f%% X %.1f%% draw %.1f%% | "
+             "%.1f moves/game | gap p50 %lluus p99 %lluus",
+             (st->moves - prev->moves) / elapsed,
+             (st->games - prev->games) / elapsed,
+             percent(st->o_wins, st->games), percent(st->x_wins, st->games),
+             percent(st->draws, st->games),
+             st->games ? (double) st->game_moves / st->games : 0.0,
+             stats_percentile(st, 50), stats_percentile(st, 99));
+}
+
+int stats_export(const char *path,
+                 const struct game_stats *st,
+                 const struct game_stats *prev,
+                 double elapsed)
+{
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp, "w");
+    if (!fp)
+        return -1;
+    fprintf(fp,
+            "{\n  \"moves\": %llu,\n  \"games\": %llu,\n"
+            "  \"moves_per_sec\": %.1f,\n  \"games_per_sec\": %.2f,\n"
+            "  \"o_wins\": %llu,\n  \"x_wins\": %llu,\n  \"draws\": %llu,\n"
+            "  \"avg_game_length\": %.2f,\n  \"interarrival_us\": {",
+            st->moves, st->games, (st->moves - prev->moves) / elapsed,
+            (st->games - prev->games) / elapsed, st->o_wins, st->x_wins,
+            st->draws,
+            st->games ? (double) st->game_moves / st->games : 0.0);
+    const char *sep = "";
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        if (!st->latency[i])
+            continue;
+        fprintf(fp, "%s\n    \"%llu\": %llu", sep, 1ULL << i, st->latency[i]);
+        sep = ",";
+    }
+    fprintf(fp, "\n  }\n}\n");
+    if (fclose(fp))
+        return -1;
+    return rename(tmp, path);
+}
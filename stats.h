@@ -0,0 +1,83 @@
+#ifndef STATS_H
+#define STATS_H
+
+/* Aggregate metrics of the games followed by xo-user */
+
+#include <stddef.h>
+
+/* Inter-arrival times are bucketed by powers of two microseconds */
+#define LATENCY_BUCKETS 32
+
+/**
+ * struct game_stats - Counters since xo-user started
+ * @moves: moves received
+ * @games: games finished
+ * @o_wins: games won by O, the MCTS player
+ * @x_wins: games won by X, the negamax player
+ * @draws: games drawn
+ * @game_moves: moves of the finished games
+ * @latency: packages of a game received 2^(i-1) to 2^i microseconds after
+ *           the previous one, as timestamped by the module
+ * @n_latency: samples in @latency
+ */
+struct game_stats {
+    unsigned long long moves, games;
+    unsigned long long o_wins, x_wins, draws;
+    unsigned long long game_moves;
+    unsigned long long latency[LATENCY_BUCKETS];
+    unsigned long long n_latency;
+};
+
+/**
+ * stats_interval() - Account for the time between two packages of a game
+ * @st: statistics to update
+ * @ns: nanoseconds between the timestamps of the packages
+ */
+void stats_interval(struct game_stats *st, unsigned long long ns);
+
+/**
+ * stats_game() - Account for a finished game
+ * @st: statistics to update
+ * @result: 'O', 'X' or 'D'
+ * @len: number of moves of the game
+ */
+void stats_game(struct game_stats *st, char result, int len);
+
+/**
+ * stats_percentile() - Inter-arrival time below which @p percent fall
+ * @st: statistics to look into
+ * @p: percentile, 0 to 100
+ *
+ * Return: upper bound of the bucket, in microseconds, 0 without samples
+ */
+unsigned long long stats_percentile(const struct game_stats *st, int p);
+
+/**
+ * stats_format() - One-line summary
+ * @buf: buffer for the line
+ * @size: size of @buf
+ * @st: statistics now
+ * @prev: statistics @elapsed seconds ago, for the rates
+ * @elapsed: seconds between @prev and @st
+ */
+void stats_format(char *buf,
+                  size_t size,
+                  const struct game_stats *st,
+                  const struct game_stats *prev,
+                  double elapsed);
+
+/**
+ * stats_export() - Replace @path with the statistics as JSON
+ * @path: file to write, replaced atomically
+ * @st: statistics now
+ * @prev: statistics @elapsed seconds ago, for the rates
+ * @elapsed: seconds between @prev and @st
+ *
+ * Return: 0 on success, -1 with errno set on failure
+ */
+int stats_export(const char *path,
+                 const struct game_stats *st,
+                 const struct game_stats *prev,
+                 double elapsed);
+
+#endif /* STATS_H */
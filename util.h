@@ -1,46 +1,32 @@
 #pragma once
 
 #include "game.h"
+#include "game_tables.h"
 
-static inline int eval_line_segment_score(const char *table,
-                                          char player,
-                                          int i,
-                                          int j,
-                                          line_t line)
+/* Score a segment from the point of view of @player: 10^(n-1) for n stones of
+ * @player alone, the opposite for n stones of the opponent alone, and 0 if the
+ * segment is empty or holds stones of both sides.
+ */
+static inline int eval_segment_score(const char *table, char player, int s)
 {
-    int score = 0;
+    int own = 0, other = 0;
     for (int k = 0; k < GOAL; k++) {
-        char curr =
-            table[GET_INDEX(i + k * line.i_shift, j + k * line.j_shift)];
-        if (curr == player) {
-            if (score < 0)
-                return 0;
-            if (score)
-                score *= 10;
-            else
-                score = 1;
-        } else if (curr != ' ') {
-            if (score > 0)
-                return 0;
-            if (score)
-                score *= 10;
-            else
-                score = -1;
-        }
+        char curr = table[segment_squares[s][k]];
+        if (curr == player)
+            own++;
+        else if (curr != ' ')
+            other++;
     }
-    return score;
+    if (own && other)
+        return 0;
+    return own ? segment_scores[own] : -segment_scores[other];
 }
 
 static inline int get_score(const char *table, char player)
 {
     int score = 0;
-    for (int i_line = 0; i_line < 4; ++i_line) {
-        line_t line = lines[i_line];
-        for (int i = line.i_lower_bound; i < line.i_upper_bound; ++i) {
-            for (int j = line.j_lower_bound; j < line.j_upper_bound; ++j) {
-                score += eval_line_segment_score(table, player, i, j, line);
-            }
-        }
-    }
+    UNROLL_SEGMENTS
+    for (int s = 0; s < N_SEGMENTS; s++)
+        score += eval_segment_score(table, player, s);
     return score;
 }
@@ -0,0 +1,313 @@
+/* xo-bench: userspace microbenchmarks for the kxo game engines
+ *
+ * Every benchmark runs on positions generated from a fixed seed, so numbers
+ * from different builds are directly comparable. Results are printed one per
+ * line as CSV (benchmark,case,value,unit) or as a JSON array.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bitboard.h"
+#include "game.h"
+#include "mcts.h"
+#include "negamax.h"
+#include "util.h"
+#include "xoroshiro.h"
+
+#define CORPUS_SIZE 4096
+#define SUITE_SIZE 4
+#define DEFAULT_SEED 20250101ULL
+
+static char corpus[CORPUS_SIZE][N_GRIDS];
+static char suite[SUITE_SIZE][N_GRIDS];
+static struct state_array rng;
+
+static enum { FORMAT_CSV, FORMAT_JSON } format = FORMAT_CSV;
+static int n_reported;
+
+/* Scale factor for the number of calls; lowered by --quick */
+static int scale = 10;
+
+static volatile long sink;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void report(const char *bench,
+                   const char *param,
+                   double value,
+                   const char *unit)
+{
+    if (format == FORMAT_JSON) {
+        printf("%s\n  {\"benchmark\": \"%s\", \"case\": \"%s\", "
+               "\"value\": %.3f, \"unit\": \"%s\"}",
+               n_reported ? "," : "[", bench, param, value, unit);
+    } else {
+        if (!n_reported)
+            printf("benchmark,case,value,unit\n");
+        printf("%s,%s,%.3f,%s\n", bench, param, value, unit);
+    }
+    n_reported++;
+}
+
+/* Play up to @plies random moves from the empty board. Returns the number of
+ * moves actually played, which is smaller if the game ended early.
+ */
+static int random_position(char *table, int plies)
+{
+    char player = 'O';
+    int played = 0;
+
+    memset(table, ' ', N_GRIDS);
+    while (played < plies && check_win(table) == ' ') {
+        int empty[N_GRIDS], n = 0;
+        for_each_empty_grid (i, table)
+            empty[n++] = i;
+        table[empty[xoro_next(&rng) % n]] = player;
+        player ^= 'O' ^ 'X';
+        played++;
+    }
+    return played;
+}
+
+static char side_to_move(const char *table)
+{
+    int n_o = 0, n_x = 0;
+    for (int i = 0; i < N_GRIDS; i++) {
+        n_o += table[i] == 'O';
+        n_x += table[i] == 'X';
+    }
+    return n_o > n_x ? 'X' : 'O';
+}
+
+static void build_positions(unsigned long long seed)
+{
+    rng.array[0] = seed;
+    rng.array[1] = seed ^ 0x9e3779b97f4a7c15ULL;
+
+    for (int i = 0; i < CORPUS_SIZE; i++)
+        random_position(corpus[i], xoro_next(&rng) % (N_GRIDS + 1));
+
+    /* The search suite only holds positions which are still in play */
+    for (int i = 0; i < SUITE_SIZE; i++) {
+        do {
+            random_position(suite[i], i * 2);
+        } while (check_win(suite[i]) != ' ');
+    }
+}
+
+static void bench_check_win(void)
+{
+    int calls = scale * 100000;
+    long acc = 0;
+
+    long long start = now_ns();
+    for (int i = 0; i < calls; i++)
+        acc += check_win(corpus[i % CORPUS_SIZE]);
+    long long elapsed = now_ns() - start;
+    sink = acc;
+
+    report("check_win", "corpus", (double) elapsed / calls, "ns/call");
+}
+
+static void bench_check_win_batch(void)
+{
+    static struct bitboard boards[CORPUS_SIZE];
+    static char expected[CORPUS_SIZE], results[CORPUS_SIZE];
+    static const enum batch_impl impls[] = {BATCH_SCALAR, BATCH_SSE2,
+                                            BATCH_AVX2};
+    int reps = scale * 100000 / CORPUS_SIZE;
+
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        bitboard_from_table(&boards[i], corpus[i]);
+        expected[i] = check_win(corpus[i]);
+    }
+
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        const char *name = check_win_batch_select(impls[k]);
+        if (!name)
+            continue;
+
+        check_win_batch(boards, CORPUS_SIZE, results);
+        if (memcmp(results, expected, CORPUS_SIZE)) {
+            fprintf(stderr, "check_win_batch (%s) disagrees with check_win\n",
+                    name);
+            exit(1);
+        }
+
+        long long start = now_ns();
+        for (int r = 0; r < reps; r++)
+            check_win_batch(boards, CORPUS_SIZE, results);
+        long long elapsed = now_ns() - start;
+        sink = results[0];
+
+        report("check_win_batch", name,
+               (double) elapsed / ((long long) reps * CORPUS_SIZE),
+               "ns/board");
+    }
+    check_win_batch_select(BATCH_AUTO);
+}
+
+static void bench_get_score(void)
+{
+    int calls = scale * 100000;
+    long acc = 0;
+
+    long long start = now_ns();
+    for (int i = 0; i < calls; i++)
+        acc += get_score(corpus[i % CORPUS_SIZE], i & 1 ? 'X' : 'O');
+    long long elapsed = now_ns() - start;
+    sink = acc;
+
+    report("get_score", "corpus", (double) elapsed / calls, "ns/call");
+}
+
+static void bench_simulate(void)
+{
+    static const int batches[] = {1, 8};
+
+    mcts_init();
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        int calls = scale * 10000 / batches[b], done = 0;
+        char param[32];
+        long acc = 0;
+
+        long long start = now_ns();
+        for (int i = 0; done < calls; i++) {
+            const char *table = corpus[i % CORPUS_SIZE];
+            if (check_win(table) != ' ')
+                continue;
+            acc += simulate_batch(table, side_to_move(table), batches[b]);
+            done++;
+        }
+        long long elapsed = now_ns() - start;
+        sink = acc;
+
+        snprintf(param, sizeof(param), "batch%d", batches[b]);
+        report("simulate", param, (double) calls * batches[b] * 1e9 / elapsed,
+               "rollouts/s");
+    }
+}
+
+static void bench_mcts(void)
+{
+    int reps = scale >= 10 ? 3 : 1;
+
+    mcts_init();
+    for (int i = 0; i < SUITE_SIZE; i++) {
+        char param[32];
+        long long nodes = 0;
+
+        long long start = now_ns();
+        for (int r = 0; r < reps; r++) {
+            sink = mcts(suite[i], side_to_move(suite[i]));
+            nodes += mcts_nr_active_nodes();
+        }
+        long long elapsed = now_ns() - start;
+
+        snprintf(param, sizeof(param), "pos%d", i);
+        report("mcts", param, (double) ITERATIONS * reps * 1e9 / elapsed,
+               "iterations/s");
+        report("mcts_nodes", param, (double) nodes / reps, "nodes/move");
+    }
+}
+
+static void bench_negamax(void)
+{
+    negamax_init();
+    for (int i = 0; i < SUITE_SIZE; i++) {
+        for (int depth = 2; depth <= MAX_SEARCH_DEPTH; depth += 2) {
+            char table[N_GRIDS], param[32];
+            memcpy(table, suite[i], N_GRIDS);
+
+            unsigned long nodes = negamax_nr_nodes();
+            long long start = now_ns();
+            sink = negamax_predict_depth(table, side_to_move(table), depth)
+                       .move;
+            long long elapsed = now_ns() - start;
+            nodes = negamax_nr_nodes() - nodes;
+
+            snprintf(param, sizeof(param), "pos%d/depth%d", i, depth);
+            report("negamax_time", param, elapsed / 1e3, "us");
+            report("negamax", param, nodes * 1e9 / elapsed, "nodes/s");
+        }
+    }
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} benches[] = {
+    {"check_win", bench_check_win},
+    {"check_win_batch", bench_check_win_batch},
+    {"get_score", bench_get_score},
+    {"simulate", bench_simulate},
+    {"mcts", bench_mcts},
+    {"negamax", bench_negamax},
+};
+
+#define N_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-j] [-q] [-s seed] [benchmark...]\n"
+            "  -j       print results as JSON instead of CSV\n"
+            "  -q       quick run with fewer calls per benchmark\n"
+            "  -s seed  seed for the generated positions\n"
+            "Benchmarks:",
+            prog);
+    for (size_t i = 0; i < N_BENCHES; i++)
+        fprintf(stderr, " %s", benches[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long seed = DEFAULT_SEED;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "jqs:h")) != -1) {
+        switch (opt) {
+        case 'j':
+            format = FORMAT_JSON;
+            break;
+        case 'q':
+            scale = 1;
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    build_positions(seed);
+
+    report("config", "board_size", BOARD_SIZE, "squares");
+    report("config", "goal", GOAL, "squares");
+    report("config", "mcts_iterations", ITERATIONS, "iterations");
+    report("config", "seed", seed, "");
+
+    for (size_t i = 0; i < N_BENCHES; i++) {
+        int selected = optind == argc;
+        for (int j = optind; j < argc; j++)
+            selected |= !strcmp(argv[j], benches[i].name);
+        if (selected)
+            benches[i].run();
+    }
+
+    if (format == FORMAT_JSON)
+        printf("%s]\n", n_reported ? "\n" : "[");
+    return 0;
+}
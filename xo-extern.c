@@ -0,0 +1,243 @@
+/* xo-extern: play one side of a kxo game with a userspace engine
+ *
+ * The device is opened for writing and one side of its game declared
+ * external, so the module waits on that side's turns for a move written into
+ * the file. Whenever poll() reports that a move is awaited, the board is
+ * fetched, searched with the engines of the module built for userspace, and
+ * the move written back. The packages of the game are drained along the way.
+ *
+ * The wall time of every search, and of every turn from the move being
+ * awaited to being written, is reported at the end, to compare with the
+ * timings of the in-kernel engines logged by the module.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "game.h"
+#include "kxo_ioctl.h"
+#include "kxo_pkg.h"
+#include "mcts.h"
+#include "negamax.h"
+
+#define XO_DEVICE_FILE "/dev/kxo"
+
+/* Packages fetched per read() */
+#define READ_BATCH 64
+
+/**
+ * struct samples - Durations of one kind, in nanoseconds
+ * @ns: storage for @cap durations, the first @n of which are in use
+ * @n: durations recorded
+ * @cap: durations @ns has room for
+ */
+struct samples {
+    double *ns;
+    size_t n, cap;
+};
+
+static volatile sig_atomic_t interrupted;
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    interrupted = 1;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void samples_add(struct samples *s, double ns)
+{
+    if (s->n == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 1024;
+        double *p = realloc(s->ns, cap * sizeof(*p));
+        if (!p)
+            return;
+        s->ns = p;
+        s->cap = cap;
+    }
+    s->ns[s->n++] = ns;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void samples_report(const char *name, struct samples *s)
+{
+    double sum = 0;
+
+    if (!s->n)
+        return;
+    qsort(s->ns, s->n, sizeof(*s->ns), cmp_double);
+    for (size_t i = 0; i < s->n; i++)
+        sum += s->ns[i];
+    printf("%-8s %8zu %10.1f %10.1f %10.1f %10.1f\n", name, s->n,
+           sum / s->n / 1e3, s->ns[s->n / 2] / 1e3,
+           s->ns[s->n * 99 / 100] / 1e3, s->ns[s->n - 1] / 1e3);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-s side] [-e engine] [-i iterations] [-r rollouts] "
+            "[-d depth] [-n games]\n"
+            "  -s side        side to play, O or X (default X)\n"
+            "  -e engine      mcts or negamax (default: the module's engine "
+            "of that side)\n"
+            "  -i iterations  MCTS iterations (default %d)\n"
+            "  -r rollouts    MCTS rollouts per leaf (default 1)\n"
+            "  -d depth       negamax depth (default %d)\n"
+            "  -n games       stop after that many games (default: when "
+            "interrupted)\n",
+            prog, ITERATIONS, MAX_SEARCH_DEPTH);
+}
+
+int main(int argc, char *argv[])
+{
+    struct mcts_config mcts_cfg = {.iterations = ITERATIONS, .rollouts = 1};
+    const char *engine = NULL;
+    int depth = MAX_SEARCH_DEPTH, max_games = 0;
+    char side = 'X';
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:e:i:r:d:n:h")) != -1) {
+        switch (opt) {
+        case 's':
+            side = optarg[0];
+            break;
+        case 'e':
+            engine = optarg;
+            break;
+        case 'i':
+            mcts_cfg.iterations = atoi(optarg);
+            break;
+        case 'r':
+            mcts_cfg.rollouts = atoi(optarg);
+            break;
+        case 'd':
+            depth = atoi(optarg);
+            break;
+        case 'n':
+            max_games = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (!engine)
+        engine = side == 'O' ? "mcts" : "negamax";
+    bool use_mcts = !strcmp(engine, "mcts");
+    if ((side != 'O' && side != 'X') ||
+        (!use_mcts && strcmp(engine, "negamax")) ||
+        mcts_cfg.iterations < 1 || mcts_cfg.rollouts < 1 ||
+        mcts_cfg.rollouts > MCTS_MAX_ROLLOUTS || depth < 2 ||
+        max_games < 0 || optind != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int fd = open(XO_DEVICE_FILE, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        perror(XO_DEVICE_FILE);
+        return 1;
+    }
+    struct kxo_board board;
+    if (ioctl(fd, KXO_IOC_GET_BOARD, &board) < 0 ||
+        ioctl(fd, KXO_IOC_SET_EXTERNAL, side) < 0) {
+        perror("The module does not take external moves");
+        return 1;
+    }
+    if (board.size != BOARD_SIZE) {
+        fprintf(stderr, "kxo plays on %dx%d boards: rebuild with the same "
+                        "board configuration\n",
+                board.size, board.size);
+        return 1;
+    }
+
+    mcts_init();
+    negamax_init();
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    struct samples search = {0}, turn = {0};
+    long games = 0, wins = 0, losses = 0, rejected = 0;
+    while (!interrupted && (!max_games || games < max_games)) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN | POLLOUT};
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        double awaited = now_ns();
+
+        if (pfd.revents & POLLIN) {
+            struct package pkgs[READ_BATCH];
+            ssize_t len;
+            while ((len = read(fd, pkgs, sizeof(pkgs))) > 0) {
+                for (size_t i = 0; i < len / sizeof(*pkgs); i++) {
+                    if (!PKG_GET_END(pkgs[i].val))
+                        continue;
+                    games++;
+                    wins += pkgs[i].result == side;
+                    losses += pkgs[i].result == (side ^ 'O' ^ 'X');
+                }
+            }
+        }
+        if (!(pfd.revents & POLLOUT))
+            continue;
+
+        if (ioctl(fd, KXO_IOC_GET_BOARD, &board) < 0) {
+            perror("KXO_IOC_GET_BOARD");
+            break;
+        }
+        if (!board.awaiting)
+            continue;
+
+        double start = now_ns();
+        int move = use_mcts
+                       ? mcts_search(board.table, side, &mcts_cfg)
+                       : negamax_predict_depth(board.table, side, depth).move;
+        samples_add(&search, now_ns() - start);
+
+        if (write(fd, &move, sizeof(move)) < 0) {
+            if (errno != EINVAL) {
+                perror("write");
+                break;
+            }
+            rejected++;
+        }
+        samples_add(&turn, now_ns() - awaited);
+    }
+    ioctl(fd, KXO_IOC_SET_EXTERNAL, ' ');
+    close(fd);
+
+    printf("%ld games as %c with %s: %ld won, %ld lost, %ld drawn, %ld moves "
+           "rejected\n",
+           games, side, engine, wins, losses, games - wins - losses, rejected);
+    printf("%-8s %8s %10s %10s %10s %10s\n", "time", "moves", "avg us",
+           "p50 us", "p99 us", "max us");
+    samples_report("search", &search);
+    samples_report("turn", &turn);
+    free(search.ns);
+    free(turn.ns);
+    return 0;
+}
@@ -0,0 +1,649 @@
+/* xo-load: stress the kxo device with many concurrent consumers
+ *
+ * Every thread plays the games of its own opens of /dev/kxo: it waits for
+ * packages with poll(), reads them with a buffer of one of the given sizes,
+ * and closes and reopens the device at a given rate to churn through games.
+ * Another thread may toggle the display flag of the module at a given rate.
+ * With -a, the threads instead keep the analysis service of the module busy
+ * with batches of random positions, or with -A, with asynchronous jobs kept
+ * in flight and reaped as an eventfd signals their completion. With -m, they
+ * sample the snapshot page of their game mapped into memory. The time spent
+ * in every call is recorded into per-thread histograms, merged and reported
+ * at the end with the throughput, to show contention on the locks of the
+ * module.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "control.h"
+#include "kxo_pkg.h"
+
+#define XO_DEVICE_FILE "/dev/kxo"
+
+#define MAX_SIZES 16
+
+/* Wait for packages at most this long, to notice the end of the run */
+#define POLL_TIMEOUT_MS 50
+
+/* Latencies are bucketed by powers of two nanoseconds */
+#define HIST_BUCKETS 48
+
+/**
+ * struct hist - Latency histogram of one kind of call
+ * @count: calls recorded
+ * @sum: total time of the calls, in nanoseconds
+ * @max: longest call, in nanoseconds
+ * @buckets: calls which took 2^(i-1) to 2^i nanoseconds
+ */
+struct hist {
+    uint64_t count, sum, max;
+    uint64_t buckets[HIST_BUCKETS];
+};
+
+enum {
+    OP_OPEN,
+    OP_READ,
+    OP_CLOSE,
+    OP_CONTROL,
+    OP_ANALYZE,
+    OP_SUBMIT,
+    OP_REAP,
+    OP_JOB, /* from submission to reaping */
+    OP_SAMPLE,
+    N_OPS
+};
+
+static const char *const op_names[N_OPS] = {
+    "open",   "read", "close", "control", "analyze",
+    "submit", "reap", "job",   "sample",
+};
+
+/**
+ * struct worker - One consumer thread
+ * @thread: the thread
+ * @size: bytes asked for per read()
+ * @hist: time spent per kind of call
+ * @bytes: bytes read
+ * @games: games finished, as told by the packages ending them
+ * @empty: reads which found nothing, after poll() said otherwise
+ * @positions: positions analyzed
+ * @errors: failed calls
+ * @samples: copies taken of the snapshot page
+ * @retries: copies of the snapshot page retried, an update being under way
+ * @updates: samples which found the snapshot updated since the previous one
+ */
+struct worker {
+    pthread_t thread;
+    size_t size;
+    struct hist hist[N_OPS];
+    uint64_t bytes, games, empty, positions, errors;
+    uint64_t samples, retries, updates;
+};
+
+static double duration = 10;
+static double open_rate; /* reopens per second and thread, 0 for none */
+static double control_rate; /* display toggles per second, 0 for none */
+static int analyze_n; /* positions per analysis batch, 0 to play games */
+static int async_depth; /* analysis jobs in flight per thread, 0 for none */
+static bool sample_mode; /* sample the snapshot page instead of reading */
+static int analyze_engine = KXO_ENGINE_MCTS;
+static int analyze_budget; /* 0 for the module's default */
+/* Set by the main thread at the end of the run, polled by the workers */
+static bool stop;
+
+static bool stopped(void)
+{
+    return __atomic_load_n(&stop, __ATOMIC_RELAXED);
+}
+
+static void stop_all(void)
+{
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void hist_add(struct hist *h, uint64_t ns)
+{
+    int bucket = 0;
+
+    for (uint64_t v = ns; v && bucket < HIST_BUCKETS - 1; v >>= 1)
+        bucket++;
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum += ns;
+    if (ns > h->max)
+        h->max = ns;
+}
+
+static void hist_merge(struct hist *into, const struct hist *h)
+{
+    into->count += h->count;
+    into->sum += h->sum;
+    if (h->max > into->max)
+        into->max = h->max;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        into->buckets[i] += h->buckets[i];
+}
+
+/* Upper bound of the bucket below which @p percent of the calls fall */
+static uint64_t hist_percentile(const struct hist *h, int p)
+{
+    uint64_t seen = 0;
+
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen * 100 >= h->count * p)
+            return (1ULL << i) < h->max ? 1ULL << i : h->max;
+    }
+    return h->max;
+}
+
+static void sleep_ns(uint64_t ns)
+{
+    struct timespec ts = {ns / 1000000000ULL, ns % 1000000000ULL};
+    while (nanosleep(&ts, &ts) && errno == EINTR)
+        ;
+}
+
+/* The analysis ioctls need @flags to be O_RDWR, the others read only */
+static int timed_open(struct worker *w, int flags)
+{
+    uint64_t t = now_ns();
+    int fd = open(XO_DEVICE_FILE, flags | O_NONBLOCK);
+    hist_add(&w->hist[OP_OPEN], now_ns() - t);
+    if (fd < 0)
+        w->errors++;
+    return fd;
+}
+
+static void timed_close(struct worker *w, int fd)
+{
+    uint64_t t = now_ns();
+    if (close(fd))
+        w->errors++;
+    hist_add(&w->hist[OP_CLOSE], now_ns() - t);
+}
+
+static void timed_read(struct worker *w, int fd, char *buf)
+{
+    uint64_t t = now_ns();
+    ssize_t len = read(fd, buf, w->size);
+    hist_add(&w->hist[OP_READ], now_ns() - t);
+
+    if (len < 0) {
+        if (errno == EAGAIN)
+            w->empty++;
+        else
+            w->errors++;
+        return;
+    }
+    w->bytes += len;
+    for (size_t i = 0; i + sizeof(struct package) <= (size_t) len;
+         i += sizeof(struct package)) {
+        const struct package *pkg = (const struct package *) (buf + i);
+        w->games += PKG_GET_END(pkg->val);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    char *buf = malloc(w->size);
+    uint64_t reopen_ns = open_rate > 0 ? 1e9 / open_rate : 0;
+
+    if (!buf) {
+        w->errors++;
+        return NULL;
+    }
+    while (!stopped()) {
+        int fd = timed_open(w, O_RDONLY);
+        if (fd < 0) {
+            sleep_ns(POLL_TIMEOUT_MS * 1000000ULL);
+            continue;
+        }
+
+        uint64_t deadline = reopen_ns ? now_ns() + reopen_ns : UINT64_MAX;
+        while (!stopped() && now_ns() < deadline) {
+            struct pollfd pfd = {.fd = fd, .events = POLLIN};
+            uint64_t left = (deadline - now_ns()) / 1000000;
+            int timeout = left < POLL_TIMEOUT_MS ? left : POLL_TIMEOUT_MS;
+
+            if (poll(&pfd, 1, timeout) > 0)
+                timed_read(w, fd, buf);
+        }
+        timed_close(w, fd);
+    }
+    free(buf);
+    return NULL;
+}
+
+/* Random position a few moves into a game, possibly already over */
+static void random_position(struct kxo_position *pos,
+                            int n_grids,
+                            unsigned int *seed)
+{
+    int plies = rand_r(seed) % (n_grids / 2);
+
+    memset(pos, 0, sizeof(*pos));
+    memset(pos->table, ' ', n_grids);
+    pos->player = 'O';
+    for (int i = 0; i < plies; i++) {
+        int move = rand_r(seed) % n_grids;
+        while (pos->table[move] != ' ')
+            move = (move + 1) % n_grids;
+        pos->table[move] = pos->player;
+        pos->player ^= 'O' ^ 'X';
+    }
+    pos->engine = analyze_engine;
+    pos->budget = analyze_budget;
+}
+
+/* Submit batches of analyze_n random positions until the end of the run */
+static void *analyzer_main(void *arg)
+{
+    struct worker *w = arg;
+    struct kxo_position *pos = calloc(analyze_n, sizeof(*pos));
+    unsigned int seed = now_ns() ^ (uintptr_t) w;
+    struct kxo_board board;
+    int fd = timed_open(w, O_RDWR);
+
+    if (fd < 0 || !pos || ioctl(fd, KXO_IOC_GET_BOARD, &board) < 0) {
+        w->errors++;
+        goto out;
+    }
+    while (!stopped()) {
+        struct kxo_analysis batch = {
+            .n = analyze_n,
+            .positions = (uintptr_t) pos,
+        };
+        for (int i = 0; i < analyze_n; i++)
+            random_position(&pos[i], board.size * board.size, &seed);
+
+        uint64_t t = now_ns();
+        int ret = ioctl(fd, KXO_IOC_ANALYZE, &batch);
+        hist_add(&w->hist[OP_ANALYZE], now_ns() - t);
+        if (ret < 0) {
+            w->errors++;
+            break;
+        }
+        w->positions += analyze_n;
+    }
+out:
+    if (fd >= 0)
+        timed_close(w, fd);
+    free(pos);
+    return NULL;
+}
+
+/* Keep async_depth analysis jobs in flight, reaping them as they complete.
+ * A job's id is the slot of its submission time.
+ */
+static void *async_main(void *arg)
+{
+    struct worker *w = arg;
+    struct kxo_job *submit = calloc(async_depth, sizeof(*submit));
+    struct kxo_job *done = calloc(async_depth, sizeof(*done));
+    uint64_t *submitted = calloc(async_depth, sizeof(*submitted));
+    int *free_slots = calloc(async_depth, sizeof(*free_slots));
+    unsigned int seed = now_ns() ^ (uintptr_t) w;
+    int n_free = async_depth;
+    struct kxo_board board;
+    int efd = eventfd(0, EFD_NONBLOCK);
+    int fd = timed_open(w, O_RDWR);
+
+    if (fd < 0 || efd < 0 || !submit || !done || !submitted || !free_slots ||
+        ioctl(fd, KXO_IOC_GET_BOARD, &board) < 0 ||
+        ioctl(fd, KXO_IOC_SET_EVENTFD, efd) < 0) {
+        w->errors++;
+        goto out;
+    }
+    for (int i = 0; i < async_depth; i++)
+        free_slots[i] = i;
+
+    while (!stopped()) {
+        int n = 0;
+        while (n_free) {
+            int slot = free_slots[--n_free];
+            submit[n].id = slot;
+            random_position(&submit[n].pos, board.size * board.size, &seed);
+            submitted[slot] = now_ns();
+            n++;
+        }
+        if (n) {
+            struct kxo_jobs req = {.n = n, .jobs = (uintptr_t) submit};
+            uint64_t t = now_ns();
+            int ret = ioctl(fd, KXO_IOC_SUBMIT, &req);
+            hist_add(&w->hist[OP_SUBMIT], now_ns() - t);
+            if (ret < 0) {
+                if (errno != EAGAIN) {
+                    w->errors++;
+                    break;
+                }
+                ret = 0;
+            }
+            /* Take back the slots of the jobs not taken */
+            for (int i = ret; i < n; i++)
+                free_slots[n_free++] = submit[i].id;
+        }
+
+        struct pollfd pfd = {.fd = efd, .events = POLLIN};
+        uint64_t completed;
+        if (poll(&pfd, 1, POLL_TIMEOUT_MS) <= 0 ||
+            read(efd, &completed, sizeof(completed)) < 0)
+            continue;
+
+        struct kxo_jobs req = {.n = async_depth, .jobs = (uintptr_t) done};
+        uint64_t t = now_ns();
+        int ret = ioctl(fd, KXO_IOC_REAP, &req);
+        hist_add(&w->hist[OP_REAP], now_ns() - t);
+        if (ret < 0) {
+            w->errors++;
+            break;
+        }
+        t = now_ns();
+        for (int i = 0; i < ret; i++) {
+            int slot = done[i].id;
+            hist_add(&w->hist[OP_JOB], t - submitted[slot]);
+            free_slots[n_free++] = slot;
+        }
+        w->positions += ret;
+    }
+out:
+    /* Closing the device waits for the jobs still running */
+    if (fd >= 0)
+        timed_close(w, fd);
+    if (efd >= 0)
+        close(efd);
+    free(submit);
+    free(done);
+    free(submitted);
+    free(free_slots);
+    return NULL;
+}
+
+/* Copy the snapshot at @snap, retrying while it is being updated, and return
+ * the number of retries
+ */
+static int snapshot_read(const struct kxo_snapshot *snap,
+                         struct kxo_snapshot *copy)
+{
+    int retries = 0;
+
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+        if (!(seq & 1)) {
+            memcpy(copy, snap, sizeof(*copy));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&snap->seq, __ATOMIC_RELAXED) == seq)
+                return retries;
+        }
+        retries++;
+    }
+}
+
+/* Sample the snapshot page of a game as fast as possible */
+static void *sampler_main(void *arg)
+{
+    struct worker *w = arg;
+    const struct kxo_snapshot *snap = MAP_FAILED;
+    long page_size = sysconf(_SC_PAGESIZE);
+    uint32_t last_seq = 0;
+    int fd = timed_open(w, O_RDONLY);
+
+    if (fd >= 0)
+        snap = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (snap == MAP_FAILED) {
+        w->errors++;
+        goto out;
+    }
+    while (!stopped()) {
+        struct kxo_snapshot copy;
+        uint64_t t = now_ns();
+        w->retries += snapshot_read(snap, &copy);
+        hist_add(&w->hist[OP_SAMPLE], now_ns() - t);
+        w->samples++;
+        w->updates += copy.seq != last_seq;
+        last_seq = copy.seq;
+    }
+    munmap((void *) snap, page_size);
+out:
+    if (fd >= 0)
+        timed_close(w, fd);
+    return NULL;
+}
+
+/* Toggle the display flag of the module control_rate times per second */
+static void *control_main(void *arg)
+{
+    struct worker *w = arg;
+    struct control ctl;
+    int fd = open(XO_DEVICE_FILE, O_RDWR | O_NONBLOCK);
+    uint64_t period = 1e9 / control_rate;
+
+    if (control_open(&ctl, fd) < 0) {
+        perror("Failed to open the control interface");
+        w->errors++;
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    for (int display = 0; !stopped(); display ^= 1) {
+        struct kxo_cmd cmd = {.op = KXO_CMD_DISPLAY, .arg = display};
+        uint64_t t = now_ns();
+        if (control_apply(&ctl, &cmd, 1) < 0)
+            w->errors++;
+        hist_add(&w->hist[OP_CONTROL], now_ns() - t);
+        sleep_ns(period);
+    }
+
+    /* Leave the boards displayed */
+    struct kxo_cmd cmd = {.op = KXO_CMD_DISPLAY, .arg = 1};
+    control_apply(&ctl, &cmd, 1);
+    control_close(&ctl);
+    if (fd >= 0)
+        close(fd);
+    return NULL;
+}
+
+static void report(struct worker *workers, int n_workers, double elapsed)
+{
+    struct hist total[N_OPS];
+    uint64_t bytes = 0, games = 0, empty = 0, positions = 0, errors = 0;
+    uint64_t samples = 0, retries = 0, updates = 0;
+
+    memset(total, 0, sizeof(total));
+    for (int i = 0; i < n_workers; i++) {
+        for (int op = 0; op < N_OPS; op++)
+            hist_merge(&total[op], &workers[i].hist[op]);
+        bytes += workers[i].bytes;
+        games += workers[i].games;
+        empty += workers[i].empty;
+        positions += workers[i].positions;
+        errors += workers[i].errors;
+        samples += workers[i].samples;
+        retries += workers[i].retries;
+        updates += workers[i].updates;
+    }
+
+    printf("%.1f s: %.0f packages/s, %.1f games/s, %.1f KiB/s, %llu empty "
+           "reads, %llu errors\n",
+           elapsed, bytes / sizeof(struct package) / elapsed, games / elapsed,
+           bytes / 1024.0 / elapsed, (unsigned long long) empty,
+           (unsigned long long) errors);
+    if (positions)
+        printf("%llu positions analyzed, %.1f positions/s\n",
+               (unsigned long long) positions, positions / elapsed);
+    if (samples)
+        printf("%llu snapshots sampled, %.0f samples/s, %llu updates seen, "
+               "%llu retries\n",
+               (unsigned long long) samples, samples / elapsed,
+               (unsigned long long) updates, (unsigned long long) retries);
+    printf("%-8s %10s %10s %9s %9s %9s %9s %9s\n", "call", "count", "per s",
+           "avg us", "p50 us", "p90 us", "p99 us", "max us");
+    for (int op = 0; op < N_OPS; op++) {
+        const struct hist *h = &total[op];
+        if (!h->count)
+            continue;
+        printf("%-8s %10llu %10.0f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+               op_names[op], (unsigned long long) h->count,
+               h->count / elapsed, h->sum / 1e3 / h->count,
+               hist_percentile(h, 50) / 1e3, hist_percentile(h, 90) / 1e3,
+               hist_percentile(h, 99) / 1e3, h->max / 1e3);
+    }
+}
+
+/* Parse a comma-separated list of buffer sizes */
+static int parse_sizes(char *arg, size_t *sizes)
+{
+    int n = 0;
+
+    for (char *s = strtok(arg, ","); s; s = strtok(NULL, ",")) {
+        long size = atol(s);
+        if (n == MAX_SIZES || size < (long) sizeof(struct package))
+            return -1;
+        sizes[n++] = size;
+    }
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-t threads] [-d seconds] [-b sizes] [-o rate] "
+            "[-c rate]\n"
+            "  -t threads  consumer threads, each with a game open "
+            "(default 4)\n"
+            "  -d seconds  duration of the run (default 10)\n"
+            "  -b sizes    comma-separated read() sizes in bytes, given to "
+            "the\n"
+            "              threads in turn (default %zu)\n"
+            "  -o rate     close and reopen the device rate times per second "
+            "in\n"
+            "              every thread (default 0: never)\n"
+            "  -c rate     toggle the display flag rate times per second "
+            "(default 0)\n"
+            "  -a n        analyze batches of n random positions instead of "
+            "playing\n"
+            "  -A n        keep n asynchronous analysis jobs in flight instead "
+            "of\n"
+            "              playing\n"
+            "  -m          sample the mapped snapshot page instead of "
+            "reading\n"
+            "  -e engine   engine of the analysis, mcts or negamax "
+            "(default mcts)\n"
+            "  -i budget   MCTS iterations or negamax depth of the analysis "
+            "(default:\n"
+            "              the module's)\n",
+            prog, 512 * sizeof(struct package));
+}
+
+int main(int argc, char *argv[])
+{
+    size_t sizes[MAX_SIZES] = {512 * sizeof(struct package)};
+    int n_threads = 4, n_sizes = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:d:b:o:c:a:A:me:i:h")) != -1) {
+        switch (opt) {
+        case 't':
+            n_threads = atoi(optarg);
+            break;
+        case 'd':
+            duration = atof(optarg);
+            break;
+        case 'b':
+            n_sizes = parse_sizes(optarg, sizes);
+            break;
+        case 'o':
+            open_rate = atof(optarg);
+            break;
+        case 'c':
+            control_rate = atof(optarg);
+            break;
+        case 'a':
+            analyze_n = atoi(optarg);
+            break;
+        case 'A':
+            async_depth = atoi(optarg);
+            break;
+        case 'm':
+            sample_mode = true;
+            break;
+        case 'e':
+            if (!strcmp(optarg, "negamax"))
+                analyze_engine = KXO_ENGINE_NEGAMAX;
+            else if (strcmp(optarg, "mcts")) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'i':
+            analyze_budget = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (n_threads < 1 || duration <= 0 || n_sizes < 1 || open_rate < 0 ||
+        control_rate < 0 || analyze_n < 0 || analyze_n > KXO_MAX_POSITIONS ||
+        async_depth < 0 || async_depth > KXO_MAX_JOBS ||
+        analyze_budget < 0 || optind != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* The control thread, if any, is the last worker */
+    int n_workers = n_threads + (control_rate > 0);
+    struct worker *workers = calloc(n_workers, sizeof(*workers));
+    if (!workers) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < n_workers; i++) {
+        struct worker *w = &workers[i];
+        w->size = sizes[i % n_sizes];
+        void *(*fn)(void *) = i == n_threads     ? control_main
+                              : sample_mode     ? sampler_main
+                              : async_depth > 0 ? async_main
+                              : analyze_n > 0   ? analyzer_main
+                                                : worker_main;
+        if (pthread_create(&w->thread, NULL, fn, w)) {
+            fprintf(stderr, "Failed to start thread %d\n", i);
+            stop_all();
+            n_workers = i;
+            break;
+        }
+    }
+    if (!stopped())
+        sleep_ns(duration * 1e9);
+    stop_all();
+    for (int i = 0; i < n_workers; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    report(workers, n_workers, (now_ns() - start) / 1e9);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,315 @@
+/* xo-openings: aggregate the openings of a binary game log
+ *
+ * The first moves of every game logged by "xo-user -l" are inserted into a
+ * trie, whose nodes count the games which went through them and how those
+ * games ended. The nodes live in one flat array and link to their first child
+ * and next sibling by index, so millions of games fit in a few megabytes and
+ * are aggregated without an allocation per game. The most played lines, with
+ * the share of games each side won from them, are printed as the input of
+ * opening book generation.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "game_log.h"
+
+#define DEFAULT_DEPTH 4
+#define DEFAULT_TOP 20
+
+/**
+ * struct node - Position reached by a sequence of moves
+ * @child: index of the first child, 0 for none
+ * @sibling: index of the next child of the same parent, 0 for none
+ * @games: games which went through the position
+ * @o_wins: those of @games won by O
+ * @x_wins: those of @games won by X
+ * @move: square played to reach the position from its parent
+ */
+struct node {
+    uint32_t child, sibling;
+    uint32_t games, o_wins, x_wins;
+    uint8_t move;
+};
+
+/**
+ * struct trie - Openings of all games
+ * @nodes: storage for @cap nodes, the first @n of which are in use, the root
+ *         being the first one
+ * @n: nodes in use
+ * @cap: nodes @nodes has room for
+ */
+struct trie {
+    struct node *nodes;
+    size_t n, cap;
+};
+
+/**
+ * struct line - One of the most played lines
+ * @node: last position of the line
+ * @len: number of moves of the line
+ * @moves: squares played, in order
+ */
+struct line {
+    uint32_t node;
+    int len;
+    uint8_t moves[N_GRIDS];
+};
+
+/* Squares of the 8 symmetries of the board */
+static uint8_t symmetry[8][N_GRIDS];
+
+static void init_symmetry(void)
+{
+    const int n = BOARD_SIZE - 1;
+
+    for (int i = 0; i < N_GRIDS; i++) {
+        int r = GET_ROW(i), c = GET_COL(i);
+        symmetry[0][i] = GET_INDEX(r, c);
+        symmetry[1][i] = GET_INDEX(c, n - r);
+        symmetry[2][i] = GET_INDEX(n - r, n - c);
+        symmetry[3][i] = GET_INDEX(n - c, r);
+        symmetry[4][i] = GET_INDEX(r, n - c);
+        symmetry[5][i] = GET_INDEX(n - r, c);
+        symmetry[6][i] = GET_INDEX(c, r);
+        symmetry[7][i] = GET_INDEX(n - c, n - r);
+    }
+}
+
+/* Map @moves onto the symmetry of the board which makes the sequence the
+ * smallest, so that all symmetric openings share one line of the trie.
+ */
+static void canonicalize(uint8_t *moves, int len)
+{
+    uint8_t best[N_GRIDS], cur[N_GRIDS];
+
+    memcpy(best, moves, len);
+    for (int s = 1; s < 8; s++) {
+        for (int i = 0; i < len; i++)
+            cur[i] = symmetry[s][moves[i]];
+        if (memcmp(cur, best, len) < 0)
+            memcpy(best, cur, len);
+    }
+    memcpy(moves, best, len);
+}
+
+static uint32_t trie_new_node(struct trie *t, int move)
+{
+    if (t->n == t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 4096;
+        struct node *nodes = realloc(t->nodes, cap * sizeof(*nodes));
+        if (!nodes) {
+            fprintf(stderr, "out of memory after %zu nodes\n", t->n);
+            exit(1);
+        }
+        t->nodes = nodes;
+        t->cap = cap;
+    }
+    struct node *node = &t->nodes[t->n];
+    memset(node, 0, sizeof(*node));
+    node->move = move;
+    return t->n++;
+}
+
+/* Child of @parent reached by @move, created if it does not exist yet */
+static uint32_t trie_child(struct trie *t, uint32_t parent, int move)
+{
+    uint32_t prev = 0, c = t->nodes[parent].child;
+
+    while (c && t->nodes[c].move != move) {
+        prev = c;
+        c = t->nodes[c].sibling;
+    }
+    if (c)
+        return c;
+
+    c = trie_new_node(t, move);
+    if (prev)
+        t->nodes[prev].sibling = c;
+    else
+        t->nodes[parent].child = c;
+    return c;
+}
+
+static void trie_count(struct node *node, char winner)
+{
+    node->games++;
+    node->o_wins += winner == 'O';
+    node->x_wins += winner == 'X';
+}
+
+static void trie_insert(struct trie *t, const uint8_t *moves, int len,
+                        char winner)
+{
+    uint32_t node = 0;
+
+    trie_count(&t->nodes[0], winner);
+    for (int i = 0; i < len; i++) {
+        node = trie_child(t, node, moves[i]);
+        trie_count(&t->nodes[node], winner);
+    }
+}
+
+static unsigned long long aggregate(struct trie *t,
+                                    const struct game_log_view *log,
+                                    int depth,
+                                    bool merge)
+{
+    unsigned long long invalid = 0;
+    uint8_t moves[N_GRIDS];
+
+    for (size_t i = 0; i < log->n_entries; i++) {
+        const struct record *r = log_entry_at(log, i);
+        if (log_entry_is_index(r))
+            continue;
+        if (r->len > N_GRIDS) {
+            invalid++;
+            continue;
+        }
+        int len = r->len < depth ? r->len : depth;
+        for (int j = 0; j < len; j++)
+            moves[j] = record_get_move(r, j);
+        if (merge)
+            canonicalize(moves, len);
+        trie_insert(t, moves, len, r->winner);
+    }
+    return invalid;
+}
+
+/* Keep the @top most played lines in @best, most played first */
+static void offer(const struct trie *t,
+                  struct line *best,
+                  int *n_best,
+                  int top,
+                  const struct line *line)
+{
+    uint32_t games = t->nodes[line->node].games;
+    int i = *n_best < top ? (*n_best)++ : top;
+
+    while (i > 0 && t->nodes[best[i - 1].node].games < games) {
+        if (i < top)
+            best[i] = best[i - 1];
+        i--;
+    }
+    if (i < top)
+        best[i] = *line;
+}
+
+/* Walk the trie for the lines of @depth moves, and the shorter ones of games
+ * which ended before
+ */
+static void collect(const struct trie *t,
+                    struct line *line,
+                    int depth,
+                    struct line *best,
+                    int *n_best,
+                    int top)
+{
+    const struct node *node = &t->nodes[line->node];
+
+    if (line->len == depth || !node->child) {
+        if (line->len)
+            offer(t, best, n_best, top, line);
+        return;
+    }
+    for (uint32_t c = node->child; c; c = t->nodes[c].sibling) {
+        struct line next = *line;
+        next.node = c;
+        next.moves[next.len++] = t->nodes[c].move;
+        collect(t, &next, depth, best, n_best, top);
+    }
+}
+
+static double percent(uint32_t n, uint32_t total)
+{
+    return total ? 100.0 * n / total : 0.0;
+}
+
+static void report(const struct trie *t, const struct line *best, int n_best)
+{
+    const struct node *root = &t->nodes[0];
+
+    printf("games %u, %zu positions, %zu KiB\n", root->games, t->n,
+           t->n * sizeof(struct node) / 1024);
+    printf("%10s %7s %7s %7s  line\n", "games", "O win", "X win", "draw");
+    for (int i = 0; i < n_best; i++) {
+        const struct node *node = &t->nodes[best[i].node];
+        printf("%10u %6.1f%% %6.1f%% %6.1f%% ", node->games,
+               percent(node->o_wins, node->games),
+               percent(node->x_wins, node->games),
+               percent(node->games - node->o_wins - node->x_wins,
+                       node->games));
+        for (int j = 0; j < best[i].len; j++)
+            printf(" %c%d", 'A' + GET_COL(best[i].moves[j]),
+                   1 + GET_ROW(best[i].moves[j]));
+        printf("\n");
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-d depth] [-n lines] [-s] log\n"
+            "  -d depth  moves of the openings (default %d)\n"
+            "  -n lines  most played openings to print (default %d)\n"
+            "  -s        count symmetric openings as one\n",
+            prog, DEFAULT_DEPTH, DEFAULT_TOP);
+}
+
+int main(int argc, char *argv[])
+{
+    int depth = DEFAULT_DEPTH, top = DEFAULT_TOP;
+    bool merge = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:n:sh")) != -1) {
+        switch (opt) {
+        case 'd':
+            depth = atoi(optarg);
+            break;
+        case 'n':
+            top = atoi(optarg);
+            break;
+        case 's':
+            merge = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1 || depth < 1 || depth > N_GRIDS || top < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct game_log_view log;
+    if (game_log_map(&log, argv[optind]))
+        return 1;
+
+    init_symmetry();
+    struct trie trie = {0};
+    trie_new_node(&trie, 0);
+    unsigned long long invalid = aggregate(&trie, &log, depth, merge);
+    if (invalid)
+        fprintf(stderr, "skipped %llu invalid games\n", invalid);
+    game_log_unmap(&log);
+
+    struct line *best = malloc(top * sizeof(*best));
+    struct line root = {0};
+    int n_best = 0;
+    if (!best) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    collect(&trie, &root, depth, best, &n_best, top);
+    report(&trie, best, n_best);
+
+    free(best);
+    free(trie.nodes);
+    return 0;
+}
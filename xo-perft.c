@@ -0,0 +1,291 @@
+/* xo-perft: exhaustive node counting for move generation and win detection
+ *
+ * From each start position, every legal move sequence is walked up to the
+ * requested depth. For every ply the number of positions reached is counted,
+ * along with how many of them are decided (X wins, O wins, draws). Decided
+ * positions are not expanded further.
+ *
+ * The walk is repeated with every backend below. Backends must agree on all
+ * counts; any mismatch is reported and makes the tool exit with status 1, so
+ * a new move generator or win check can be validated against the reference
+ * and benchmarked (nodes/s) in one go.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bitboard.h"
+#include "game.h"
+
+#define MAX_DEPTH N_GRIDS
+
+struct perft_count {
+    unsigned long long nodes, x_wins, o_wins, draws;
+};
+
+struct perft_backend {
+    const char *name;
+    /* Store the empty squares of @table into @moves, return their number */
+    int (*moves)(const char *table, int *moves);
+    /* Same contract as check_win() */
+    char (*check_win)(const char *table);
+};
+
+/* Straightforward implementation written independently of game.c */
+static int ref_moves(const char *table, int *moves)
+{
+    int n = 0;
+    for (int i = 0; i < N_GRIDS; i++)
+        if (table[i] == ' ')
+            moves[n++] = i;
+    return n;
+}
+
+static char ref_at(const char *table, int row, int col)
+{
+    if (row < 0 || row >= BOARD_SIZE || col < 0 || col >= BOARD_SIZE)
+        return ' ';
+    return table[row * BOARD_SIZE + col];
+}
+
+static char ref_check_win(const char *table)
+{
+    static const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+
+    for (int d = 0; d < 4; d++) {
+        int dr = dirs[d][0], dc = dirs[d][1];
+        for (int row = 0; row < BOARD_SIZE; row++) {
+            for (int col = 0; col < BOARD_SIZE; col++) {
+                char c = ref_at(table, row, col);
+                int k = 1;
+                if (c == ' ')
+                    continue;
+                while (k < GOAL && ref_at(table, row + k * dr,
+                                          col + k * dc) == c)
+                    k++;
+                if (k < GOAL)
+                    continue;
+#if !ALLOW_EXCEED
+                if (ref_at(table, row - dr, col - dc) == c ||
+                    ref_at(table, row + GOAL * dr, col + GOAL * dc) == c)
+                    continue;
+#endif
+                return c;
+            }
+        }
+    }
+    for (int i = 0; i < N_GRIDS; i++)
+        if (table[i] == ' ')
+            return ' ';
+    return 'D';
+}
+
+static const struct perft_backend backends[] = {
+    {"reference", ref_moves, ref_check_win},
+    {"char", available_moves, check_win},
+    /* Walked by perft_bitboard() instead */
+    {"bitboard", NULL, NULL},
+};
+
+#define N_BACKENDS (sizeof(backends) / sizeof(backends[0]))
+
+static void perft(const struct perft_backend *b,
+                  char *table,
+                  char player,
+                  int ply,
+                  int depth,
+                  struct perft_count *count)
+{
+    int moves[N_GRIDS];
+    int n = b->moves(table, moves);
+
+    for (int i = 0; i < n; i++) {
+        struct perft_count *c = &count[ply];
+        table[moves[i]] = player;
+        c->nodes++;
+        switch (b->check_win(table)) {
+        case 'X':
+            c->x_wins++;
+            break;
+        case 'O':
+            c->o_wins++;
+            break;
+        case 'D':
+            c->draws++;
+            break;
+        default:
+            if (ply + 1 < depth)
+                perft(b, table, player ^ 'O' ^ 'X', ply + 1, depth, count);
+        }
+        table[moves[i]] = ' ';
+    }
+}
+
+/* Bitboards with incremental win detection, as used by the MCTS rollouts.
+ * @side is 0 for O and 1 for X.
+ */
+static void perft_bitboard(struct bitboard *board,
+                           int side,
+                           int ply,
+                           int depth,
+                           struct perft_count *count)
+{
+    u64 *marks = side ? &board->x : &board->o;
+    struct perft_count *c = &count[ply];
+
+    for (u64 empty = bitboard_empty(board); empty; empty &= empty - 1) {
+        int move = __ffs64(empty);
+        *marks |= 1ULL << move;
+        c->nodes++;
+        if (bitboard_wins_at(*marks, move)) {
+            if (side)
+                c->x_wins++;
+            else
+                c->o_wins++;
+        } else if (!bitboard_empty(board)) {
+            c->draws++;
+        } else if (ply + 1 < depth) {
+            perft_bitboard(board, side ^ 1, ply + 1, depth, count);
+        }
+        *marks &= ~(1ULL << move);
+    }
+}
+
+static int parse_position(const char *s, char *table, char *player)
+{
+    int n_o = 0, n_x = 0;
+
+    if (strlen(s) != N_GRIDS) {
+        fprintf(stderr, "position \"%s\" must have %d squares\n", s, N_GRIDS);
+        return -1;
+    }
+    for (int i = 0; i < N_GRIDS; i++) {
+        switch (s[i]) {
+        case 'O':
+        case 'o':
+            table[i] = 'O';
+            n_o++;
+            break;
+        case 'X':
+        case 'x':
+            table[i] = 'X';
+            n_x++;
+            break;
+        case '.':
+        case ' ':
+        case '-':
+            table[i] = ' ';
+            break;
+        default:
+            fprintf(stderr, "bad square '%c' in \"%s\"\n", s[i], s);
+            return -1;
+        }
+    }
+    if (n_o != n_x && n_o != n_x + 1) {
+        fprintf(stderr, "\"%s\" is not reachable with O moving first\n", s);
+        return -1;
+    }
+    *player = n_o > n_x ? 'X' : 'O';
+    return 0;
+}
+
+static int run_position(const char *start, int depth)
+{
+    static struct perft_count counts[N_BACKENDS][MAX_DEPTH];
+    char table[N_GRIDS], player;
+    int mismatches = 0;
+
+    if (parse_position(start, table, &player))
+        return -1;
+
+    printf("position %s, %c to move, depth %d\n", start, player, depth);
+    if (check_win(table) != ' ' || ref_check_win(table) != ' ') {
+        printf("  already decided, nothing to count\n");
+        return 0;
+    }
+
+    memset(counts, 0, sizeof(counts));
+    for (size_t b = 0; b < N_BACKENDS; b++) {
+        struct timespec t0, t1;
+        unsigned long long total = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (backends[b].moves) {
+            perft(&backends[b], table, player, 0, depth, counts[b]);
+        } else {
+            struct bitboard board;
+            bitboard_from_table(&board, table);
+            perft_bitboard(&board, player == 'X', 0, depth, counts[b]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        for (int d = 0; d < depth; d++)
+            total += counts[b][d].nodes;
+        double secs =
+            (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        printf("  %-10s %12llu nodes %10.3f s %14.0f nodes/s\n",
+               backends[b].name, total, secs, secs > 0 ? total / secs : 0.0);
+    }
+
+    printf("  %5s %14s %12s %12s %12s\n", "depth", "nodes", "X wins",
+           "O wins", "draws");
+    for (int d = 0; d < depth; d++) {
+        const struct perft_count *ref = &counts[0][d];
+        printf("  %5d %14llu %12llu %12llu %12llu\n", d + 1, ref->nodes,
+               ref->x_wins, ref->o_wins, ref->draws);
+        for (size_t b = 1; b < N_BACKENDS; b++) {
+            const struct perft_count *c = &counts[b][d];
+            if (!memcmp(c, ref, sizeof(*c)))
+                continue;
+            printf("  MISMATCH %-10s %8llu %12llu %12llu %12llu\n",
+                   backends[b].name, c->nodes, c->x_wins, c->o_wins,
+                   c->draws);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-d depth] [position...]\n"
+            "  -d depth  plies to walk from each position (default 6)\n"
+            "Positions list the %d squares row by row using O, X and '.',\n"
+            "the empty board is used if none is given.\n",
+            prog, N_GRIDS);
+}
+
+int main(int argc, char *argv[])
+{
+    char empty[N_GRIDS + 1];
+    int depth = 6, opt, failed = 0;
+
+    while ((opt = getopt(argc, argv, "d:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            depth = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (depth < 1 || depth > MAX_DEPTH) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(empty, '.', N_GRIDS);
+    empty[N_GRIDS] = '\0';
+    if (optind == argc) {
+        failed = run_position(empty, depth) != 0;
+    } else {
+        for (int i = optind; i < argc; i++)
+            failed |= run_position(argv[i], depth) != 0;
+    }
+    return failed;
+}
@@ -0,0 +1,207 @@
+/* xo-replay: replay, filter and summarize a binary game log
+ *
+ * The log written by "xo-user -l" is mapped into memory and its fixed-size
+ * entries are walked in place, so millions of games are scanned without a
+ * read() or an allocation per game. With -i, only the index entries are read
+ * to count the games and their outcomes, block by block.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "game_log.h"
+
+struct filter {
+    char winner; /* '\0' for any */
+    int min_len, max_len;
+};
+
+struct summary {
+    unsigned long long games, o_wins, x_wins, draws, moves;
+    unsigned long long lengths[N_GRIDS + 1];
+};
+
+static bool match(const struct filter *f, const struct record *r)
+{
+    return (!f->winner || r->winner == f->winner) && r->len >= f->min_len &&
+           r->len <= f->max_len;
+}
+
+/* Play @r out on an empty board, checking every move is legal and the game
+ * is over exactly at its last move.
+ */
+static bool replay(const struct record *r)
+{
+    char table[N_GRIDS];
+    char player = 'O';
+
+    memset(table, ' ', N_GRIDS);
+    for (int i = 0; i < r->len; i++) {
+        int move = record_get_move(r, i);
+        if (move >= N_GRIDS || table[move] != ' ' || check_win(table) != ' ')
+            return false;
+        table[move] = player;
+        player ^= 'O' ^ 'X';
+    }
+    return check_win(table) != ' ';
+}
+
+static void print_moves(const struct record *r)
+{
+    printf("Moves: ");
+    for (int i = 0; i < r->len; i++) {
+        int move = record_get_move(r, i);
+        printf("%c%d%s", 'A' + GET_COL(move), 1 + GET_ROW(move),
+               i < r->len - 1 ? " -> " : "");
+    }
+    printf("\n\"%c\" Win!\n", r->winner);
+}
+
+static void scan(const char *entries,
+                 size_t n_entries,
+                 const struct filter *f,
+                 bool print,
+                 bool verify,
+                 struct summary *sum)
+{
+    unsigned long long invalid = 0;
+
+    for (size_t i = 0; i < n_entries; i++) {
+        const struct record *r =
+            (const struct record *) (entries + i * LOG_ENTRY_SIZE);
+        if (log_entry_is_index(r) || !match(f, r))
+            continue;
+        if (r->len > N_GRIDS || (verify && !replay(r))) {
+            invalid++;
+            continue;
+        }
+        sum->games++;
+        sum->o_wins += r->winner == 'O';
+        sum->x_wins += r->winner == 'X';
+        sum->draws += r->winner == 'D';
+        sum->moves += r->len;
+        sum->lengths[r->len]++;
+        if (print)
+            print_moves(r);
+    }
+    if (invalid)
+        fprintf(stderr, "%llu games failed to replay\n", invalid);
+}
+
+/* Count the games from the index entries only, stepping over whole blocks.
+ * Games after the last index, from a log which was not closed, are scanned.
+ */
+static void scan_index(const char *entries,
+                       size_t n_entries,
+                       struct summary *sum)
+{
+    size_t i = 0;
+
+    while (i < n_entries) {
+        size_t next = i + LOG_INDEX_INTERVAL;
+        const char *entry = entries + next * LOG_ENTRY_SIZE;
+        struct log_index idx;
+
+        if (next >= n_entries || !log_entry_is_index(entry)) {
+            /* Short block: look for its index entry */
+            for (next = i; next < n_entries; next++) {
+                entry = entries + next * LOG_ENTRY_SIZE;
+                if (log_entry_is_index(entry))
+                    break;
+            }
+            if (next == n_entries) {
+                struct filter all = {0, 0, N_GRIDS};
+                scan(entries + i * LOG_ENTRY_SIZE, n_entries - i, &all, false,
+                     false, sum);
+                return;
+            }
+        }
+        memcpy(&idx, entry, sizeof(idx));
+        sum->games += idx.n_games;
+        sum->o_wins += idx.o_wins;
+        sum->x_wins += idx.x_wins;
+        i = next + 1;
+    }
+}
+
+static void report(const struct summary *sum, bool lengths)
+{
+    printf("games %llu\n", sum->games);
+    printf("O wins %llu, X wins %llu, other %llu\n", sum->o_wins, sum->x_wins,
+           sum->games - sum->o_wins - sum->x_wins);
+    if (!lengths || !sum->games)
+        return;
+    printf("average length %.2f\n", (double) sum->moves / sum->games);
+    for (int len = 0; len <= N_GRIDS; len++) {
+        if (sum->lengths[len])
+            printf("  %2d moves: %llu\n", len, sum->lengths[len]);
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-i] [-p] [-v] [-w winner] [-l min] [-L max] log\n"
+            "  -i         count games from the index entries only\n"
+            "  -p         print the moves of the matching games\n"
+            "  -v         replay the games, skipping the invalid ones\n"
+            "  -w winner  only games won by O or X\n"
+            "  -l min     only games of at least min moves\n"
+            "  -L max     only games of at most max moves\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    struct filter filter = {0, 0, N_GRIDS};
+    bool index_only = false, print = false, verify = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ipvw:l:L:h")) != -1) {
+        switch (opt) {
+        case 'i':
+            index_only = true;
+            break;
+        case 'p':
+            print = true;
+            break;
+        case 'v':
+            verify = true;
+            break;
+        case 'w':
+            filter.winner = optarg[0];
+            break;
+        case 'l':
+            filter.min_len = atoi(optarg);
+            break;
+        case 'L':
+            filter.max_len = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct game_log_view log;
+    if (game_log_map(&log, argv[optind]))
+        return 1;
+
+    struct summary sum;
+    memset(&sum, 0, sizeof(sum));
+    if (index_only)
+        scan_index(log.entries, log.n_entries, &sum);
+    else
+        scan(log.entries, log.n_entries, &filter, print, verify, &sum);
+    report(&sum, !index_only);
+
+    game_log_unmap(&log);
+    return 0;
+}
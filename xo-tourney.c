@@ -0,0 +1,315 @@
+/* xo-tourney: head-to-head tournaments between engine configurations
+ *
+ * Every pair of engines plays the requested number of games. Games come in
+ * pairs sharing the same random opening, with the engines swapping sides, so
+ * neither the first-move advantage nor the opening favours one of them.
+ *
+ * Engines are given as name[:key=value,...], for example
+ *     mcts                    MCTS with the built-in ITERATIONS
+ *     mcts:iterations=5000    MCTS with a smaller budget
+ *     mcts:rollouts=4         MCTS playing 4 rollouts from every new leaf
+ *     mcts:rave=300           MCTS with RAVE, equivalence parameter 300
+ *     negamax:depth=4         negamax searching 4 plies deep
+ *     random                  uniformly random legal moves
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game.h"
+#include "mcts.h"
+#include "negamax.h"
+#include "xoroshiro.h"
+
+#define MAX_ENGINES 16
+#define DEFAULT_SEED 20250101ULL
+
+enum engine_kind { ENGINE_MCTS, ENGINE_NEGAMAX, ENGINE_RANDOM };
+
+struct engine {
+    const char *spec;
+    enum engine_kind kind;
+    struct mcts_config mcts;
+    int depth;
+
+    /* CPU time spent and moves played over the whole tournament */
+    double cpu_ns;
+    long moves;
+};
+
+struct match {
+    int wins, draws, losses, illegal;
+};
+
+static struct engine engines[MAX_ENGINES];
+static int n_engines;
+static struct state_array rng;
+
+static double cpu_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int parse_engine(struct engine *e, const char *spec)
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    char *opts = strchr(buf, ':');
+    if (opts)
+        *opts++ = '\0';
+
+    memset(e, 0, sizeof(*e));
+    e->spec = spec;
+    if (!strcmp(buf, "mcts")) {
+        e->kind = ENGINE_MCTS;
+        e->mcts.iterations = ITERATIONS;
+        e->mcts.rollouts = 1;
+    } else if (!strcmp(buf, "negamax")) {
+        e->kind = ENGINE_NEGAMAX;
+        e->depth = MAX_SEARCH_DEPTH;
+    } else if (!strcmp(buf, "random")) {
+        e->kind = ENGINE_RANDOM;
+    } else {
+        fprintf(stderr, "unknown engine \"%s\"\n", buf);
+        return -1;
+    }
+
+    for (char *opt = opts ? strtok(opts, ",") : NULL; opt;
+         opt = strtok(NULL, ",")) {
+        char *val = strchr(opt, '=');
+        if (!val) {
+            fprintf(stderr, "%s: expected key=value, got \"%s\"\n", spec, opt);
+            return -1;
+        }
+        *val++ = '\0';
+        int v = atoi(val);
+        if (e->kind == ENGINE_MCTS && !strcmp(opt, "iterations") && v > 0) {
+            e->mcts.iterations = v;
+        } else if (e->kind == ENGINE_MCTS && !strcmp(opt, "rollouts") &&
+                   v > 0 && v <= MCTS_MAX_ROLLOUTS) {
+            e->mcts.rollouts = v;
+        } else if (e->kind == ENGINE_MCTS && !strcmp(opt, "rave") && v >= 0) {
+            e->mcts.rave = v;
+        } else if (e->kind == ENGINE_NEGAMAX && !strcmp(opt, "depth") &&
+                   v >= 2) {
+            e->depth = v;
+        } else {
+            fprintf(stderr, "%s: bad option \"%s=%s\"\n", spec, opt, val);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int random_move(const char *table)
+{
+    int empty[N_GRIDS], n = 0;
+    for_each_empty_grid (i, table)
+        empty[n++] = i;
+    return n ? empty[xoro_next(&rng) % n] : -1;
+}
+
+static int engine_move(struct engine *e, const char *table, char player)
+{
+    char copy[N_GRIDS];
+    int move = -1;
+
+    memcpy(copy, table, N_GRIDS);
+    double start = cpu_now_ns();
+    switch (e->kind) {
+    case ENGINE_MCTS:
+        move = mcts_search(copy, player, &e->mcts);
+        break;
+    case ENGINE_NEGAMAX:
+        move = negamax_predict_depth(copy, player, e->depth).move;
+        break;
+    case ENGINE_RANDOM:
+        move = random_move(copy);
+        break;
+    }
+    e->cpu_ns += cpu_now_ns() - start;
+    e->moves++;
+    return move;
+}
+
+/* Play one game from @opening, 'O' moving first as in kxo.ko. Returns the
+ * winner ('O', 'X' or 'D'); a side making an illegal move loses.
+ */
+static char play_game(const char *opening,
+                      struct engine *o,
+                      struct engine *x,
+                      int *illegal)
+{
+    char table[N_GRIDS], win;
+    char player = 'O';
+    int n_o = 0, n_x = 0;
+
+    memcpy(table, opening, N_GRIDS);
+    for (int i = 0; i < N_GRIDS; i++) {
+        n_o += table[i] == 'O';
+        n_x += table[i] == 'X';
+    }
+    if (n_o > n_x)
+        player = 'X';
+
+    while ((win = check_win(table)) == ' ') {
+        int move = engine_move(player == 'O' ? o : x, table, player);
+        if (move < 0 || move >= N_GRIDS || table[move] != ' ') {
+            (*illegal)++;
+            return player ^ 'O' ^ 'X';
+        }
+        table[move] = player;
+        player ^= 'O' ^ 'X';
+    }
+    return win;
+}
+
+/* Random opening of @plies moves which does not already decide the game */
+static void random_opening(char *table, int plies)
+{
+    do {
+        char player = 'O';
+        memset(table, ' ', N_GRIDS);
+        for (int i = 0; i < plies; i++) {
+            table[random_move(table)] = player;
+            player ^= 'O' ^ 'X';
+        }
+    } while (check_win(table) != ' ');
+}
+
+static void run_match(struct engine *a,
+                      struct engine *b,
+                      int n_games,
+                      int plies,
+                      struct match *m)
+{
+    char opening[N_GRIDS];
+
+    memset(m, 0, sizeof(*m));
+    for (int g = 0; g < n_games; g++) {
+        if (!(g & 1))
+            random_opening(opening, plies);
+
+        /* Alternate sides so each opening is played from both ends */
+        char a_side = (g & 1) ? 'X' : 'O';
+        char win = a_side == 'O' ? play_game(opening, a, b, &m->illegal)
+                                 : play_game(opening, b, a, &m->illegal);
+        if (win == a_side)
+            m->wins++;
+        else if (win == 'D')
+            m->draws++;
+        else
+            m->losses++;
+    }
+}
+
+static double elo(double score)
+{
+    if (score <= 0.0)
+        return -INFINITY;
+    if (score >= 1.0)
+        return INFINITY;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+static void report_match(const struct engine *a,
+                         const struct engine *b,
+                         const struct match *m)
+{
+    int n = m->wins + m->draws + m->losses;
+    double score = (m->wins + 0.5 * m->draws) / n;
+
+    /* Wilson score interval, a draw counting as half a win. Unlike the
+     * normal approximation, it keeps a width at scores of 0 or 1 and stays
+     * within [0, 1] for few games.
+     */
+    const double z = 1.96;
+    double z2n = z * z / n;
+    double center = (score + z2n / 2) / (1 + z2n);
+    double half = z / (1 + z2n) *
+                  sqrt(score * (1 - score) / n + z2n / (4.0 * n));
+    double lo = center - half, hi = center + half;
+
+    printf("%s vs %s: +%d =%d -%d (%d games", a->spec, b->spec, m->wins,
+           m->draws, m->losses, n);
+    if (m->illegal)
+        printf(", %d illegal moves", m->illegal);
+    printf(")\n");
+    printf("  score %.3f, 95%% CI [%.3f, %.3f], elo %+.0f [%+.0f, %+.0f]\n",
+           score, lo < 0 ? 0 : lo, hi > 1 ? 1 : hi, elo(score), elo(lo),
+           elo(hi));
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-n games] [-p plies] [-s seed] engine engine...\n"
+            "  -n games  games per pairing (default 1000)\n"
+            "  -p plies  random opening plies (default 2)\n"
+            "  -s seed   seed for the random openings\n"
+            "Engines: mcts[:iterations=N,rollouts=K,rave=K], "
+            "negamax[:depth=N], random\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long seed = DEFAULT_SEED;
+    int n_games = 1000, plies = 2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:s:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            n_games = atoi(optarg);
+            break;
+        case 'p':
+            plies = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind < 2 || argc - optind > MAX_ENGINES || n_games < 1 ||
+        plies < 0 || plies >= N_GRIDS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (parse_engine(&engines[n_engines++], argv[i]))
+            return 1;
+    }
+
+    rng.array[0] = seed;
+    rng.array[1] = seed ^ 0x9e3779b97f4a7c15ULL;
+    mcts_init();
+    negamax_init();
+
+    for (int i = 0; i < n_engines; i++) {
+        for (int j = i + 1; j < n_engines; j++) {
+            struct match m;
+            run_match(&engines[i], &engines[j], n_games, plies, &m);
+            report_match(&engines[i], &engines[j], &m);
+        }
+    }
+
+    printf("\nCPU time per move:\n");
+    for (int i = 0; i < n_engines; i++) {
+        const struct engine *e = &engines[i];
+        printf("  %-32s %10.3f ms (%ld moves)\n", e->spec,
+               e->moves ? e->cpu_ns / e->moves / 1e6 : 0.0, e->moves);
+    }
+    return 0;
+}
@@ -1,24 +1,79 @@
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "control.h"
 #include "game.h"
 #include "kxo_pkg.h"
-#include "record_queue.h"
+#include "game_log.h"
+#include "record_store.h"
+#include "render.h"
+#include "stats.h"
 
 #define XO_STATUS_FILE "/sys/module/kxo/initstate"
 #define XO_DEVICE_FILE "/dev/kxo"
-#define XO_DEVICE_ATTR_FILE "/sys/class/kxo/kxo/kxo_state"
+#define XO_DROPPED_FILE "/sys/class/kxo/kxo/kxo_dropped"
 
-static int move_record[N_GRIDS];
-static int move_count = 0;
-static struct list_head *head;
+/* Packages fetched from a game per read() */
+#define READ_BATCH 512
+
+/* Events handled per epoll_wait() */
+#define MAX_EVENTS 64
+
+/* Every open of the device plays a game of its own, followed here through
+ * its own fd.
+ */
+struct game {
+    int fd;
+    char table[N_GRIDS];
+    int move_record[N_GRIDS];
+    int move_count;
+    /* Number of the game on the board, as carried by its packages. A finished
+     * game stays on display until the next one makes its first move.
+     */
+    unsigned short number;
+    /* Timestamp of the last package received, 0 before the first */
+    unsigned long long last_ts;
+};
+
+static struct game *games;
+static int n_games = 1;
+
+/* Boards are redrawn at most fps times per second, with all the moves which
+ * arrived in between.
+ */
+static struct screen screen;
+static int fps = 30;
+static bool frame_dirty;
+static struct record_store store;
+
+/* Binary log of the finished games, if one was asked for */
+static struct game_log game_log;
+static bool logging;
+
+/* Headless mode: no terminal handling and no boards kept in memory, only
+ * statistics reported every report_interval seconds.
+ */
+static bool headless;
+static int report_interval = 1;
+
+/* Statistics now and at the last report, refreshed every report_interval
+ * seconds on the status line and in the export file if any.
+ */
+static struct game_stats stats, stats_prev;
+static char status_line[256];
+static const char *stats_path;
+static long long dropped_start;
+static volatile sig_atomic_t interrupted;
 
 /* Draw the board into draw_buffer */
 static int draw_board(char *table, char *draw_buffer)
@@ -79,131 +134,429 @@ static void raw_mode_enable(void)
 
 static bool read_attr, end_attr;
 
+/* Control handle on the module, opened once for all commands */
+static struct control control;
+
+static void control_send(enum kxo_cmd_op op, int arg)
+{
+    struct kxo_cmd cmd = {.op = op, .arg = arg};
+    if (control_apply(&control, &cmd, 1) < 0)
+        perror("Failed to control the module");
+}
+
 static void listen_keyboard_handler(void)
 {
-    int attr_fd = open(XO_DEVICE_ATTR_FILE, O_RDWR);
     char input;
 
     if (read(STDIN_FILENO, &input, 1) == 1) {
-        char buf[20];
         switch (input) {
         case 16: /* Ctrl-P */
-            read(attr_fd, buf, 6);
-            buf[0] = (buf[0] - '0') ? '0' : '1';
             read_attr ^= 1;
-            write(attr_fd, buf, 6);
+            control_send(KXO_CMD_DISPLAY, read_attr);
             if (!read_attr)
                 printf("Stopping to display the chess board...\n");
+            screen_invalidate(&screen);
+            frame_dirty = true;
             break;
         case 17: /* Ctrl-Q */
-            read(attr_fd, buf, 6);
-            buf[4] = '1';
             read_attr = false;
             end_attr = true;
-            write(attr_fd, buf, 6);
+            control_send(KXO_CMD_END, 1);
             printf("Stopping the kernel space tic-tac-toe game...\n");
             break;
         }
     }
-    close(attr_fd);
 }
 
-static inline void record_move(int move)
+/* Script of commands given with -c, NULL once it has ended */
+static struct control_script *script;
+
+static void script_handler(void)
+{
+    int ret = control_script_run(&control, script, &end_attr);
+    if (ret < 0)
+        perror("Failed to run the control script");
+    if (ret <= 0) {
+        close(script->fd);
+        free(script);
+        script = NULL;
+    }
+}
+
+static inline void record_move(struct game *game, int move)
 {
-    move_record[move_count++] = move;
+    game->move_record[game->move_count++] = move;
 }
 
-void record_to_queue(char winner)
+void record_to_store(struct game *game, char winner)
 {
-    if (move_count == 0)
+    if (game->move_count == 0)
         return;
-    if (!q_insert_head(head, move_record, move_count, winner)) {
-        perror("Failed to insert move into queue");
+    stats_game(&stats, winner, game->move_count);
+
+    /* Finished games are only logged when headless, to bound memory use */
+    struct record packed;
+    const struct record *record = &packed;
+    if (headless)
+        record_pack(&packed, game->move_record, game->move_count, winner);
+    else
+        record = record_store_append(&store, game->move_record,
+                                     game->move_count, winner);
+    if (!record) {
+        perror("Failed to record the game");
         return;
     }
-    move_count = 0;
+    if (logging && game_log_append(&game_log, record) < 0) {
+        perror("Failed to log the game");
+        logging = false;
+    }
+    game->move_count = 0;
 }
 
-static void print_moves(const int *record, int count)
+static void print_moves(const struct record *record)
 {
     printf("Moves: ");
-    for (int i = 0; i < count; i++) {
-        printf("%c%d", 'A' + GET_COL(record[i]), 1 + GET_ROW(record[i]));
-        if (i < count - 1) {
+    for (int i = 0; i < record->len; i++) {
+        int move = record_get_move(record, i);
+        printf("%c%d", 'A' + GET_COL(move), 1 + GET_ROW(move));
+        if (i < record->len - 1) {
             printf(" -> ");
         }
     }
     printf("\n");
 }
 
+/* Lay the boards out in a grid, as many as fit in the terminal */
+static void render_games(void)
+{
+    char display_buf[DRAWBUFFER_SIZE + 1];
+    int board_w = (BOARD_SIZE << 1) - 1;
+    int tile_w = (board_w > 10 ? board_w : 10) + 2;
+    int tile_h = (BOARD_SIZE << 1) + 2;
+    int per_row = screen.cols / tile_w > 0 ? screen.cols / tile_w : 1;
+
+    screen_clear(&screen);
+    for (int i = 0; i < n_games; i++) {
+        int row = i / per_row * tile_h, col = i % per_row * tile_w;
+        if (row + tile_h > screen.rows && i)
+            break;
+        if (n_games > 1) {
+            char title[16];
+            snprintf(title, sizeof(title), "Game %d", i + 1);
+            screen_put(&screen, row, col, title);
+        }
+        draw_board(games[i].table, display_buf);
+        display_buf[DRAWBUFFER_SIZE] = '\0';
+        screen_put(&screen, row, col, display_buf);
+    }
+    screen_put(&screen, screen.rows - 1, 0, status_line);
+    screen_flush(&screen);
+}
+
+/* Drain the packages queued for @game, up to READ_BATCH per read() */
+static void game_read_handler(struct game *game)
+{
+    static struct package pkgs[READ_BATCH];
+    ssize_t len;
+
+    while ((len = read(game->fd, pkgs, sizeof(pkgs))) > 0) {
+        int n = len / sizeof(struct package);
+
+        for (int i = 0; i < n; i++) {
+            const struct package *pkg = &pkgs[i];
+            if (pkg->move == -1 && !PKG_GET_END(pkg->val))
+                continue;
+            if (pkg->move < -1 || pkg->move >= N_GRIDS)
+                continue;
+            if (game->last_ts && pkg->ts > game->last_ts)
+                stats_interval(&stats, pkg->ts - game->last_ts);
+            game->last_ts = pkg->ts;
+            if (pkg->move != -1) {
+                if (pkg->game != game->number) {
+                    /* First move of the next game. If the package ending the
+                     * previous one was dropped, the moves recorded so far are
+                     * discarded rather than logged as a game.
+                     */
+                    memset(game->table, ' ', N_GRIDS);
+                    game->move_count = 0;
+                    game->number = pkg->game;
+                }
+                game->table[pkg->move] = PKG_GET_AI(pkg->val);
+                record_move(game, pkg->move);
+                stats.moves++;
+            }
+            frame_dirty = true;
+            if (PKG_GET_END(pkg->val))
+                record_to_store(game, pkg->result);
+        }
+        if (len < (ssize_t) sizeof(pkgs))
+            break;
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Packages the module dropped so far, -1 if it does not tell */
+static long long read_dropped(void)
+{
+    static int fd = -2;
+    char buf[32];
+
+    if (fd == -2)
+        fd = open(XO_DROPPED_FILE, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    return atoll(buf);
+}
+
+/* Refresh the status line and the export file, print it when headless */
+static void report_stats(double elapsed)
+{
+    stats_format(status_line, sizeof(status_line), &stats, &stats_prev,
+                 elapsed);
+    if (headless) {
+        long long dropped = read_dropped();
+        printf("%s", status_line);
+        if (dropped >= 0)
+            printf(" | %lld dropped", dropped - dropped_start);
+        printf("\n");
+        fflush(stdout);
+    }
+    if (stats_path && stats_export(stats_path, &stats, &stats_prev, elapsed))
+        perror(stats_path);
+    stats_prev = stats;
+}
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    interrupted = 1;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-n games] [-f fps] [-l file] [-s file] [-i seconds]\n"
+           "          [-c file] [--headless]\n"
+           "  -n games     number of games to play and follow at once "
+           "(default 1)\n"
+           "  -f fps       most boards redrawn per second (default 30)\n"
+           "  -l file      append every finished game to a binary log, see "
+           "xo-replay\n"
+           "  -s file      export the statistics as JSON to a file\n"
+           "  -i seconds   interval between statistics updates (default 1)\n"
+           "  -c file      apply the control commands of a script, one batch\n"
+           "               per line, as they are read (\"-\": stdin, when\n"
+           "               headless)\n"
+           "  --headless   no board display, print the statistics and the\n"
+           "               dropped packages until interrupted\n",
+           prog);
+}
+
 int main(int argc, char *argv[])
 {
+    static const struct option long_opts[] = {
+        {"headless", no_argument, NULL, 'H'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    const char *log_path = NULL, *script_path = NULL;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:f:l:s:i:c:h", long_opts, NULL)) !=
+           -1) {
+        switch (opt) {
+        case 's':
+            stats_path = optarg;
+            break;
+        case 'c':
+            script_path = optarg;
+            break;
+        case 'f':
+            fps = atoi(optarg);
+            if (fps >= 1)
+                break;
+            usage(argv[0]);
+            exit(1);
+        case 'H':
+            headless = true;
+            break;
+        case 'i':
+            report_interval = atoi(optarg);
+            if (report_interval >= 1)
+                break;
+            usage(argv[0]);
+            exit(1);
+        case 'l':
+            log_path = optarg;
+            break;
+        case 'n':
+            n_games = atoi(optarg);
+            if (n_games >= 1)
+                break;
+            /* fall through */
+        default:
+            usage(argv[0]);
+            exit(opt == 'h' ? 0 : 1);
+        }
+    }
+
+    if (script_path && !strcmp(script_path, "-") && !headless) {
+        usage(argv[0]);
+        exit(1);
+    }
     if (!status_check())
         exit(1);
-    raw_mode_enable();
-    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
-
-    static char table[N_GRIDS];
-    char display_buf[DRAWBUFFER_SIZE];
-    static struct package pkg_obj;
-    head = q_new();
-    if (!head) {
-        printf("Failed to create queue\n");
+
+    record_store_init(&store);
+    if (log_path) {
+        if (game_log_open(&game_log, log_path) < 0) {
+            perror(log_path);
+            exit(1);
+        }
+        logging = true;
+    }
+    games = calloc(n_games, sizeof(*games));
+    int epoll_fd = epoll_create1(0);
+    if (!games || epoll_fd < 0) {
+        printf("Failed to set up the games\n");
         exit(1);
     }
 
-    fd_set readset;
-    int device_fd = open(XO_DEVICE_FILE, O_RDONLY);
-    int max_fd = device_fd > STDIN_FILENO ? device_fd : STDIN_FILENO;
-    read_attr = true;
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (!headless)
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &ev);
+    for (int i = 0; i < n_games; i++) {
+        struct game *game = &games[i];
+        memset(game->table, ' ', N_GRIDS);
+        /* The first game doubles as the control handle, which writes */
+        game->fd =
+            open(XO_DEVICE_FILE, (i ? O_RDONLY : O_RDWR) | O_NONBLOCK);
+        ev.data.ptr = game;
+        if (game->fd < 0 ||
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, game->fd, &ev) < 0) {
+            perror("Failed to start game");
+            exit(1);
+        }
+    }
+
+    read_attr = !headless;
     end_attr = false;
 
-    while (!end_attr) {
-        FD_ZERO(&readset);
-        FD_SET(STDIN_FILENO, &readset);
-        FD_SET(device_fd, &readset);
+    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
+    if (control_open(&control, games[0].fd) < 0)
+        perror("Failed to open the control interface");
+    if (script_path) {
+        script = calloc(1, sizeof(*script));
+        if (!script) {
+            printf("Failed to set up the control script\n");
+            exit(1);
+        }
+        script->fd = strcmp(script_path, "-")
+                         ? open(script_path, O_RDONLY | O_NONBLOCK)
+                         : STDIN_FILENO;
+        if (script->fd < 0) {
+            perror(script_path);
+            exit(1);
+        }
+        fcntl(script->fd, F_SETFL, fcntl(script->fd, F_GETFL) | O_NONBLOCK);
+        ev.data.ptr = script;
+        /* Regular files cannot be polled, and are run through at once */
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, script->fd, &ev) < 0)
+            script_handler();
+    }
 
-        int result = select(max_fd + 1, &readset, NULL, NULL, NULL);
-        if (result < 0) {
-            printf("Error with select system call\n");
+    if (!headless) {
+        if (screen_init(&screen) < 0) {
+            printf("Failed to set up the screen\n");
             exit(1);
         }
-        if (FD_ISSET(STDIN_FILENO, &readset)) {
-            FD_CLR(STDIN_FILENO, &readset);
-            listen_keyboard_handler();
-        } else if (FD_ISSET(device_fd, &readset)) {
-            FD_CLR(device_fd, &readset);
-            read(device_fd, &pkg_obj, sizeof(pkg_obj));
-            if (pkg_obj.move == -1 && !PKG_GET_END(pkg_obj.val))
-                continue;
-            if (pkg_obj.move != -1) {
-                table[pkg_obj.move] = PKG_GET_AI(pkg_obj.val);
-                record_move(pkg_obj.move);
-            }
-            if (read_attr) {
-                printf(
-                    "\033[H\033[J"); /* ASCII escape code to clear the screen */
-                draw_board(table, display_buf);
-                printf("%s", display_buf);
-            }
-            if (PKG_GET_END(pkg_obj.val)) {
-                record_to_queue(PKG_GET_AI(pkg_obj.val));
-                memset(table, ' ', N_GRIDS);
-            }
+        raw_mode_enable();
+        fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+    } else {
+        signal(SIGINT, on_signal);
+        signal(SIGTERM, on_signal);
+    }
+
+    double start = now(), last = start, next_frame = start;
+    dropped_start = read_dropped();
+
+    while (!end_attr && !interrupted) {
+        struct epoll_event events[MAX_EVENTS];
+        double deadline = last + report_interval;
+        if (frame_dirty && read_attr && next_frame < deadline)
+            deadline = next_frame;
+        double wait = deadline - now();
+        int timeout = wait > 0 ? wait * 1000 + 1 : 0;
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            printf("Error with epoll_wait system call\n");
+            exit(1);
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == script && script)
+                script_handler();
+            else if (events[i].data.ptr)
+                game_read_handler(events[i].data.ptr);
+            else
+                listen_keyboard_handler();
+        }
+
+        double t = now();
+        if (t - last >= report_interval) {
+            report_stats(t - last);
+            last = t;
+            frame_dirty = true; /* for the status line */
+        }
+        if (frame_dirty && read_attr && t >= next_frame) {
+            render_games();
+            frame_dirty = false;
+            next_frame = t + 1.0 / fps;
         }
     }
 
-    element_t *entry = NULL, *safe = NULL;
-    list_for_each_entry_safe(entry, safe, head, list) {
-        print_moves(entry->value, entry->len);
-        printf("\"%c\" Win!\n", entry->ai);
+    if (headless) {
+        stats_prev = (struct game_stats) {0};
+        printf("total: %llu moves, %llu games\n", stats.moves, stats.games);
+        report_stats(now() - start);
+    }
+
+    /* Print the move list below the boards */
+    if (!headless)
+        printf("\033[%d;1H\n", screen.rows);
+
+    const struct record *record;
+    record_store_for_each(record, &store) {
+        print_moves(record);
+        printf("\"%c\" Win!\n", record->winner);
+    }
+    record_store_free(&store);
+    if (logging && game_log_close(&game_log) < 0)
+        perror("Failed to write the game log");
+    if (!headless) {
+        screen_free(&screen);
+        raw_mode_disable();
     }
-    q_free(head);
-    raw_mode_disable();
     fcntl(STDIN_FILENO, F_SETFL, flags);
 
-    close(device_fd);
+    if (script)
+        close(script->fd);
+    free(script);
+    control_close(&control);
+    for (int i = 0; i < n_games; i++)
+        close(games[i].fd);
+    close(epoll_fd);
+    free(games);
 
     return 0;
 }
@@ -6,8 +6,6 @@ u64 zobrist_table[N_GRIDS][2];
 
 #define HASH(key) ((key) % HASH_TABLE_SIZE)
 
-static struct hlist_head *hash_table;
-
 /* See https://github.com/wangyi-fudan/wyhash
  */
 static inline u64 wyhash64_stateless(u64 *seed)
@@ -34,51 +32,68 @@ void zobrist_init(void)
         zobrist_table[i][0] = wyhash64();
         zobrist_table[i][1] = wyhash64();
     }
-    hash_table =
+}
+
+struct hlist_head *zobrist_alloc(void)
+{
+    struct hlist_head *table =
         kmalloc(sizeof(struct hlist_head) * HASH_TABLE_SIZE, GFP_KERNEL);
-    if (!hash_table) {
+
+    if (!table) {
         pr_info("kxo: Failed to allocate space for hash_table\n");
-        return;
+        return NULL;
     }
-    for (i = 0; i < HASH_TABLE_SIZE; i++)
-        INIT_HLIST_HEAD(&hash_table[i]);
+    for (int i = 0; i < HASH_TABLE_SIZE; i++)
+        INIT_HLIST_HEAD(&table[i]);
+    return table;
+}
+
+void zobrist_free(struct hlist_head *table)
+{
+    if (!table)
+        return;
+    zobrist_clear(table);
+    kfree(table);
 }
 
-zobrist_entry_t *zobrist_get(u64 key)
+zobrist_entry_t *zobrist_get(struct hlist_head *table, u64 key)
 {
     unsigned long long hash_key = HASH(key);
 
-    if (hlist_empty(&hash_table[hash_key]))
+    if (hlist_empty(&table[hash_key]))
         return NULL;
 
     zobrist_entry_t *entry = NULL;
 
-    hlist_for_each_entry(entry, &hash_table[hash_key], ht_list) {
+    hlist_for_each_entry(entry, &table[hash_key], ht_list) {
         if (entry->key == key)
             return entry;
     }
     return NULL;
 }
 
-void zobrist_put(u64 key, int score, int move)
+void zobrist_put(struct hlist_head *table, u64 key, int score, int move)
 {
     unsigned long long hash_key = HASH(key);
     zobrist_entry_t *new_entry = kmalloc(sizeof(zobrist_entry_t), GFP_KERNEL);
+    /* Only a cache: the search goes on without the entry */
+    if (!new_entry)
+        return;
     new_entry->key = key;
     new_entry->move = move;
     new_entry->score = score;
-    hlist_add_head(&new_entry->ht_list, &hash_table[hash_key]);
+    hlist_add_head(&new_entry->ht_list, &table[hash_key]);
 }
 
-void zobrist_clear(void)
+void zobrist_clear(struct hlist_head *table)
 {
     for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        while (!hlist_empty(&hash_table[i])) {
+        while (!hlist_empty(&table[i])) {
             zobrist_entry_t *entry =
-                hlist_entry(hash_table[i].first, zobrist_entry_t, ht_list);
+                hlist_entry(table[i].first, zobrist_entry_t, ht_list);
             hlist_del(&entry->ht_list);
             kfree(entry);
         }
-        INIT_HLIST_HEAD(&hash_table[i]);
+        INIT_HLIST_HEAD(&table[i]);
     }
 }
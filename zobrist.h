@@ -16,6 +16,14 @@ typedef struct {
 } zobrist_entry_t;
 
 void zobrist_init(void);
-zobrist_entry_t *zobrist_get(u64 key);
-void zobrist_put(u64 key, int score, int move);
-void zobrist_clear(void);
+
+/* Transposition tables are arrays of HASH_TABLE_SIZE buckets, one per search
+ * that may run concurrently with the others. zobrist_alloc() returns NULL if
+ * out of memory, and zobrist_free() also frees the entries left.
+ */
+struct hlist_head *zobrist_alloc(void);
+void zobrist_free(struct hlist_head *table);
+
+zobrist_entry_t *zobrist_get(struct hlist_head *table, u64 key);
+void zobrist_put(struct hlist_head *table, u64 key, int score, int move);
+void zobrist_clear(struct hlist_head *table);